@@ -0,0 +1,161 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+namespace audio {
+    /* the sum of squares and the largest magnitude of a channel, everything the analyzer needs from the samples */
+    struct Level {
+        float sumOfSquares, peak;
+    };
+
+    namespace kernel {
+        inline Level measureScalar(const float* samples, const int num) noexcept {
+            Level level{ 0.f, 0.f };
+            for (auto i = 0; i < num; ++i) {
+                level.sumOfSquares += samples[i] * samples[i];
+                level.peak = juce::jmax(level.peak, std::abs(samples[i]));
+            }
+            return level;
+        }
+        inline Level measure(const float* samples, const int num) noexcept {
+#if JUCE_INTEL
+            const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            auto sum = _mm_setzero_ps();
+            auto peak = _mm_setzero_ps();
+            auto i = 0;
+            for (; i + 4 <= num; i += 4) {
+                const auto x = _mm_loadu_ps(samples + i);
+                sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+                peak = _mm_max_ps(peak, _mm_and_ps(x, absMask));
+            }
+            alignas(16) float sums[4], peaks[4];
+            _mm_store_ps(sums, sum);
+            _mm_store_ps(peaks, peak);
+            auto level = measureScalar(samples + i, num - i);
+            level.sumOfSquares += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+            level.peak = juce::jmax(level.peak, peaks[0], peaks[1], juce::jmax(peaks[2], peaks[3]));
+            return level;
+#else
+            return measureScalar(samples, num);
+#endif
+        }
+    }
+
+    /* what the audio thread found out about the input since the last event */
+    struct Event {
+        double timeMs; // juce::Time::getMillisecondCounterHiRes() of the block that completed the hop
+        float rms, peak, envelope;
+        bool onset;
+    };
+
+    /* wait-free queue for exactly one producer and one consumer. push drops the value if the queue is full */
+    template<typename T, int Capacity>
+    class Fifo {
+    public:
+        Fifo() :
+            fifo(Capacity),
+            buffer()
+        {}
+        bool push(const T& value) noexcept {
+            int start1, size1, start2, size2;
+            fifo.prepareToWrite(1, start1, size1, start2, size2);
+            if (size1 + size2 == 0) return false;
+            buffer[static_cast<size_t>(size1 > 0 ? start1 : start2)] = value;
+            fifo.finishedWrite(1);
+            return true;
+        }
+        bool pop(T& value) noexcept {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead(1, start1, size1, start2, size2);
+            if (size1 + size2 == 0) return false;
+            value = buffer[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+            fifo.finishedRead(1);
+            return true;
+        }
+    private:
+        juce::AbstractFifo fifo;
+        std::array<T, Capacity> buffer;
+
+        JUCE_DECLARE_NON_COPYABLE(Fifo)
+    };
+
+    /* envelope follower and onset detector for the input. blocks get cut into hops of hopSize samples,
+    so neither depends on the host's buffer size. onsets are hops much louder than the last half second.
+    process never allocates or locks */
+    class Analyzer {
+    public:
+        static constexpr int hopSize = 256;
+        static constexpr double attackSec = .01, releaseSec = .2, averageSec = .5, holdSec = .08;
+        static constexpr float onsetRatio = 4.f, onsetFloor = .01f;
+
+        Analyzer() :
+            attack(0.f), release(0.f), average(0.f),
+            holdHops(0),
+            sumOfSquares(0.f), peak(0.f), numSamples(0),
+            rms(0.f), hopPeak(0.f), envelope(0.f), averageEnergy(0.f),
+            hopsToHold(0)
+        { prepare(44100.); }
+        void prepare(const double sampleRate) noexcept {
+            const auto hopSec = static_cast<double>(hopSize) / (sampleRate > 0. ? sampleRate : 44100.);
+            attack = getCoefficient(hopSec, attackSec);
+            release = getCoefficient(hopSec, releaseSec);
+            average = getCoefficient(hopSec, averageSec);
+            holdHops = static_cast<int>(std::ceil(holdSec / hopSec));
+            sumOfSquares = peak = rms = hopPeak = envelope = averageEnergy = 0.f;
+            numSamples = hopsToHold = 0;
+        }
+        /* returns true and fills event if at least one hop was completed. event holds the last hop's levels,
+        and an onset if any of the hops had one */
+        bool process(const juce::AudioBuffer<float>& buffer, const double timeMs, Event& event) noexcept {
+            const auto numChannels = buffer.getNumChannels();
+            const auto num = buffer.getNumSamples();
+            if (numChannels == 0) return false;
+            auto completed = false, onset = false;
+            for (auto start = 0; start < num;) {
+                const auto len = juce::jmin(num - start, hopSize - numSamples);
+                for (auto ch = 0; ch < numChannels; ++ch) {
+                    const auto level = kernel::measure(buffer.getReadPointer(ch, start), len);
+                    sumOfSquares += level.sumOfSquares / static_cast<float>(numChannels);
+                    peak = juce::jmax(peak, level.peak);
+                }
+                start += len;
+                numSamples += len;
+                if (numSamples == hopSize) {
+                    onset = finishHop() || onset;
+                    completed = true;
+                }
+            }
+            if (completed)
+                event = { timeMs, rms, hopPeak, envelope, onset };
+            return completed;
+        }
+    private:
+        float attack, release, average;
+        int holdHops;
+        float sumOfSquares, peak;
+        int numSamples;
+        float rms, hopPeak, envelope, averageEnergy;
+        int hopsToHold;
+
+        /* returns true if the hop was an onset */
+        bool finishHop() noexcept {
+            const auto energy = sumOfSquares / static_cast<float>(hopSize);
+            rms = std::sqrt(energy);
+            hopPeak = peak;
+            envelope += (rms - envelope) * (rms > envelope ? attack : release);
+            const auto onset = hopsToHold == 0 && rms > onsetFloor && energy > averageEnergy * onsetRatio;
+            hopsToHold = onset ? holdHops : juce::jmax(0, hopsToHold - 1);
+            averageEnergy += (energy - averageEnergy) * average;
+            sumOfSquares = peak = 0.f;
+            numSamples = 0;
+            return onset;
+        }
+        /* one-pole smoothing that reaches 63% after timeSec */
+        static float getCoefficient(const double hopSec, const double timeSec) noexcept {
+            return static_cast<float>(1. - std::exp(-hopSec / timeSec));
+        }
+    };
+}
@@ -0,0 +1,388 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "JIF.h"
+#include "Wavetable.h"
+#include "AudioAnalysis.h"
+
+/* measures decoding, compositing, painting, scrubbing and wavetable export over generated gifs,
+and the input analysis of the audio-reactive modes at the buffer sizes hosts use.
+prints the results as json, so they can be compared across commits */
+
+namespace bench {
+    /* what a generated gif looks like */
+    struct Spec {
+        const char* name;
+        int width, height, numFrames;
+        bool interlaced, transparent, localPalettes, partialFrames;
+    };
+
+    /* writes gifs with a real lzw encoder, so the decoder sees the same code patterns as with exported gifs */
+    class Encoder {
+    public:
+        Encoder(const Spec& s) :
+            spec(s),
+            bytes(),
+            block(),
+            bitBuffer(0),
+            numBits(0)
+        {}
+        std::vector<std::uint8_t> encode() {
+            bytes.clear();
+            writeString("GIF89a");
+            writeShort(spec.width);
+            writeShort(spec.height);
+            bytes.push_back(0xf7); // global palette with 256 colours
+            bytes.push_back(0);
+            bytes.push_back(0);
+            writePalette(0);
+            for (auto f = 0; f < spec.numFrames; ++f)
+                writeFrame(f);
+            bytes.push_back(';');
+            return bytes;
+        }
+    private:
+        const Spec& spec;
+        std::vector<std::uint8_t> bytes, block;
+        std::uint32_t bitBuffer;
+        int numBits;
+
+        void writeString(const char* str) {
+            while (*str != 0)
+                bytes.push_back(static_cast<std::uint8_t>(*str++));
+        }
+        void writeShort(const int value) {
+            bytes.push_back(static_cast<std::uint8_t>(value & 0xff));
+            bytes.push_back(static_cast<std::uint8_t>((value >> 8) & 0xff));
+        }
+        void writePalette(const int seed) {
+            for (auto i = 0; i < 256; ++i) {
+                bytes.push_back(static_cast<std::uint8_t>(i + seed * 37));
+                bytes.push_back(static_cast<std::uint8_t>(255 - i + seed * 11));
+                bytes.push_back(static_cast<std::uint8_t>(i * 7 + seed * 3));
+            }
+        }
+        /* moving stripes and blocks with a bit of noise, which compresses about as well as a typical gif */
+        std::uint8_t getPixel(const int x, const int y, const int frame) const noexcept {
+            if (spec.transparent && ((x / 16 + y / 16 + frame) % 5) == 0)
+                return 0;
+            const auto noise = static_cast<int>((static_cast<unsigned>(x * 73856093) ^ static_cast<unsigned>(y * 19349663) ^ static_cast<unsigned>(frame * 83492791)) % 7);
+            return static_cast<std::uint8_t>(1 + ((x + frame * 3) / 6 + y / 9 + (noise == 0 ? noise : 0)) % 255);
+        }
+        void writeFrame(const int frame) {
+            auto x = 0, y = 0, w = spec.width, h = spec.height;
+            if (spec.partialFrames && frame != 0) {
+                x = spec.width / 4;
+                y = spec.height / 4;
+                w = spec.width / 2;
+                h = spec.height / 2;
+            }
+            // graphic control extension
+            bytes.push_back('!');
+            bytes.push_back(0xf9);
+            bytes.push_back(4);
+            const auto disposal = spec.partialFrames ? 1 : 2;
+            bytes.push_back(static_cast<std::uint8_t>((disposal << 2) | (spec.transparent ? 1 : 0)));
+            writeShort(4 + frame % 3);
+            bytes.push_back(0);
+            bytes.push_back(0);
+            // image descriptor
+            bytes.push_back(',');
+            writeShort(x);
+            writeShort(y);
+            writeShort(w);
+            writeShort(h);
+            bytes.push_back(static_cast<std::uint8_t>((spec.localPalettes ? 0x87 : 0) | (spec.interlaced ? 0x40 : 0)));
+            if (spec.localPalettes)
+                writePalette(frame + 1);
+            std::vector<std::uint8_t> pixels;
+            pixels.reserve(static_cast<size_t>(w * h));
+            for (const auto row : getRowOrder(h))
+                for (auto col = 0; col < w; ++col)
+                    pixels.push_back(getPixel(x + col, y + row, frame));
+            writeLZW(pixels);
+        }
+        std::vector<int> getRowOrder(const int h) const {
+            std::vector<int> rows;
+            if (!spec.interlaced) {
+                for (auto row = 0; row < h; ++row)
+                    rows.push_back(row);
+                return rows;
+            }
+            const int starts[] = { 0, 4, 2, 1 }, steps[] = { 8, 8, 4, 2 };
+            for (auto pass = 0; pass < 4; ++pass)
+                for (auto row = starts[pass]; row < h; row += steps[pass])
+                    rows.push_back(row);
+            return rows;
+        }
+        void writeLZW(const std::vector<std::uint8_t>& pixels) {
+            static constexpr int minCodeSize = 8, clearCode = 1 << minCodeSize, endCode = clearCode + 1, maxCodes = 4096;
+            bytes.push_back(minCodeSize);
+            std::vector<std::array<std::uint16_t, 256>> next(maxCodes);
+            const auto clearTable = [&]() { for (auto& n : next) n.fill(0); };
+            clearTable();
+            auto codeSize = minCodeSize + 1;
+            auto maxCode = endCode;
+            writeCode(clearCode, codeSize);
+            auto prefix = -1;
+            for (const auto pixel : pixels) {
+                if (prefix < 0) {
+                    prefix = pixel;
+                    continue;
+                }
+                const auto code = next[static_cast<size_t>(prefix)][pixel];
+                if (code != 0) {
+                    prefix = code;
+                    continue;
+                }
+                writeCode(prefix, codeSize);
+                next[static_cast<size_t>(prefix)][pixel] = static_cast<std::uint16_t>(++maxCode);
+                if (maxCode >= (1 << codeSize))
+                    ++codeSize;
+                if (maxCode == maxCodes - 1) {
+                    writeCode(clearCode, codeSize);
+                    clearTable();
+                    codeSize = minCodeSize + 1;
+                    maxCode = endCode;
+                }
+                prefix = pixel;
+            }
+            if (prefix >= 0)
+                writeCode(prefix, codeSize);
+            writeCode(endCode, codeSize);
+            if (numBits > 0)
+                block.push_back(static_cast<std::uint8_t>(bitBuffer & 0xff));
+            bitBuffer = 0;
+            numBits = 0;
+            flushBlock();
+            bytes.push_back(0);
+        }
+        void writeCode(const int code, const int codeSize) {
+            bitBuffer |= static_cast<std::uint32_t>(code) << numBits;
+            numBits += codeSize;
+            while (numBits >= 8) {
+                block.push_back(static_cast<std::uint8_t>(bitBuffer & 0xff));
+                bitBuffer >>= 8;
+                numBits -= 8;
+                if (block.size() == 255)
+                    flushBlock();
+            }
+        }
+        void flushBlock() {
+            if (block.empty())
+                return;
+            bytes.push_back(static_cast<std::uint8_t>(block.size()));
+            bytes.insert(bytes.end(), block.begin(), block.end());
+            block.clear();
+        }
+    };
+
+    /* the most memory the process ever had resident, in bytes. only known on linux */
+    static juce::int64 getPeakResidentBytes() {
+#if JUCE_LINUX
+        const auto status = juce::File("/proc/self/status").loadFileAsString();
+        for (const auto& line : juce::StringArray::fromLines(status))
+            if (line.startsWith("VmHWM:"))
+                return line.fromFirstOccurrenceOf(":", false, false).trim().getLargeIntValue() * 1024;
+#endif
+        return 0;
+    }
+
+    static double getMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    struct AsyncLoad {
+        double totalMs, decodeMs;
+    };
+
+    /* loads a file the way the plugin does. the total includes mapping and hashing it and polling for the result,
+    the decode time is only the part on the thread pool */
+    static AsyncLoad measureAsyncLoad(const juce::File& file) {
+        const auto startMs = getMs();
+        jif::AsyncLoader loader;
+        jif::JIF jif;
+        loader.load(file);
+        while (loader.collect(jif) != jif::AsyncLoader::Status::Finished)
+            juce::Thread::sleep(1);
+        return { getMs() - startMs, loader.getDecodeMs() };
+    }
+
+    static juce::var run(const Spec& spec, const juce::File& tempDir, const int numRepeats) {
+        const auto gif = Encoder(spec).encode();
+        const auto numBytes = static_cast<double>(gif.size());
+        auto result = std::make_unique<juce::DynamicObject>();
+        result->setProperty("name", spec.name);
+        result->setProperty("width", spec.width);
+        result->setProperty("height", spec.height);
+        result->setProperty("frames", spec.numFrames);
+        result->setProperty("bytes", static_cast<juce::int64>(gif.size()));
+
+        jif::JIF jif;
+        auto startMs = getMs();
+        for (auto i = 0; i < numRepeats; ++i)
+            jif.reload(gif.data(), gif.size());
+        const auto decodeMs = (getMs() - startMs) / numRepeats;
+        result->setProperty("decodeMs", decodeMs);
+        result->setProperty("decodeMBps", numBytes / (1024. * 1024.) / (decodeMs * .001));
+        result->setProperty("decodeFramesPerSec", static_cast<double>(jif.numImages()) / (decodeMs * .001));
+
+        /* the key the cache looks decoded gifs up by */
+        startMs = getMs();
+        auto key = static_cast<juce::uint64>(0);
+        for (auto i = 0; i < numRepeats; ++i)
+            key ^= jif::Cache::getKey(gif.data(), gif.size());
+        const auto hashMs = (getMs() - startMs) / numRepeats;
+        result->setProperty("hashMs", hashMs);
+        result->setProperty("hashMBps", numBytes / (1024. * 1024.) / (hashMs * .001));
+        result->setProperty("hashKey", juce::String::toHexString(static_cast<juce::int64>(key)));
+
+        const auto file = tempDir.getChildFile(juce::String(spec.name) + ".gif");
+        file.replaceWithData(gif.data(), gif.size());
+        const auto asyncLoad = measureAsyncLoad(file);
+        result->setProperty("asyncLoadMs", asyncLoad.totalMs);
+        result->setProperty("asyncDecodeMs", asyncLoad.decodeMs);
+        result->setProperty("asyncDecodeMBps", numBytes / (1024. * 1024.) / (asyncLoad.decodeMs * .001));
+
+        /* every frame in order, painted scaled the way the viewer does it */
+        juce::Image target(juce::Image::RGB, 400, 300, true, juce::SoftwareImageType());
+        const auto bounds = target.getBounds().toFloat();
+        auto maxPaintMs = 0.;
+        startMs = getMs();
+        for (auto i = 0; i < numRepeats; ++i)
+            for (auto idx = 0; idx < static_cast<int>(jif.numImages()); ++idx) {
+                const auto frameStartMs = getMs();
+                jif.setFrameTo(idx);
+                juce::Graphics g{ target };
+                g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+                jif.paint(g, bounds);
+                maxPaintMs = juce::jmax(maxPaintMs, getMs() - frameStartMs);
+            }
+        const auto numPainted = static_cast<double>(jif.numImages()) * numRepeats;
+        result->setProperty("paintMsPerFrame", (getMs() - startMs) / numPainted);
+        result->setProperty("paintMsMax", maxPaintMs);
+
+        /* random jumps, which is what the phase knob and hosts that loop do to the compositor */
+        juce::Random rand(420);
+        const auto numScrubs = 200 * numRepeats;
+        startMs = getMs();
+        for (auto i = 0; i < numScrubs; ++i) {
+            jif.setFrameTo(rand.nextFloat(), 0.f);
+            jif.getFrame(jif.readIdx);
+        }
+        result->setProperty("scrubMsPerJump", (getMs() - startMs) / numScrubs);
+
+        /* the crossfade between 2 frames scaled to a full hd window, the worst case where every pixel changes */
+        if (jif.numImages() > 1) {
+            juce::Image a(juce::Image::RGB, 1920, 1080, false, juce::SoftwareImageType());
+            juce::Image b(juce::Image::RGB, 1920, 1080, false, juce::SoftwareImageType());
+            juce::Image blended;
+            {
+                juce::Graphics ga{ a };
+                ga.drawImage(jif.getFrame(0), a.getBounds().toFloat());
+                juce::Graphics gb{ b };
+                gb.drawImage(jif.getFrame(1), b.getBounds().toFloat());
+            }
+            jif::crossfade(a, b, blended, a.getBounds(), .5f);
+            const auto numBlends = 50 * numRepeats;
+            startMs = getMs();
+            for (auto i = 0; i < numBlends; ++i)
+                jif::crossfade(a, b, blended, a.getBounds(), static_cast<float>(i % 64) / 64.f);
+            result->setProperty("crossfade1080pMs", (getMs() - startMs) / numBlends);
+        }
+
+        wt::Exporter exporter;
+        startMs = getMs();
+        exporter.exportNow(jif, tempDir.getChildFile(juce::String(spec.name) + ".wav"), { wt::Exporter::Mode::SingleFile, 2048 });
+        const auto exportMs = getMs() - startMs;
+        result->setProperty("exportMs", exportMs);
+        result->setProperty("exportFramesPerSec", static_cast<double>(jif.numImages()) / (exportMs * .001));
+
+        result->setProperty("residentBytes", static_cast<juce::int64>(jif.getResidentBytes()));
+        result->setProperty("peakResidentBytes", getPeakResidentBytes());
+        return juce::var(result.release());
+    }
+
+    /* 10 seconds of stereo noise with a hit every 250 ms, analyzed the way processBlock does it at every buffer size */
+    static juce::Array<juce::var> runAnalysis(const int numRepeats) {
+        static constexpr double sampleRate = 44100.;
+        const auto length = static_cast<int>(sampleRate * 10.);
+        juce::AudioBuffer<float> input(2, length);
+        juce::Random rand(420);
+        for (auto ch = 0; ch < 2; ++ch) {
+            auto samples = input.getWritePointer(ch);
+            for (auto i = 0; i < length; ++i) {
+                const auto sinceHit = i % static_cast<int>(sampleRate * .25);
+                const auto gain = .05f + .9f * std::exp(-static_cast<float>(sinceHit) / 2000.f);
+                samples[i] = (rand.nextFloat() * 2.f - 1.f) * gain;
+            }
+        }
+        juce::Array<juce::var> results;
+        for (auto blockSize = 32; blockSize <= 4096; blockSize *= 2) {
+            audio::Analyzer analyzer;
+            audio::Event event;
+            auto numOnsets = 0;
+            auto maxBlockUs = 0.;
+            const auto numBlocks = length / blockSize;
+            const auto startMs = getMs();
+            for (auto r = 0; r < numRepeats; ++r) {
+                analyzer.prepare(sampleRate);
+                numOnsets = 0;
+                for (auto b = 0; b < numBlocks; ++b) {
+                    const juce::AudioBuffer<float> block(input.getArrayOfWritePointers(), 2, b * blockSize, blockSize);
+                    const auto blockStartMs = getMs();
+                    if (analyzer.process(block, blockStartMs, event) && event.onset)
+                        ++numOnsets;
+                    maxBlockUs = juce::jmax(maxBlockUs, (getMs() - blockStartMs) * 1000.);
+                }
+            }
+            const auto totalMs = getMs() - startMs;
+            auto result = std::make_unique<juce::DynamicObject>();
+            result->setProperty("blockSize", blockSize);
+            result->setProperty("usPerBlock", totalMs * 1000. / (numBlocks * numRepeats));
+            result->setProperty("usPerBlockMax", maxBlockUs);
+            result->setProperty("nsPerSample", totalMs * 1e6 / (static_cast<double>(numBlocks) * blockSize * numRepeats));
+            result->setProperty("onsets", numOnsets);
+            results.add(juce::var(result.release()));
+        }
+        return results;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+    const auto numRepeats = juce::jmax(1, args.containsOption("--repeats") ? args.getValueForOption("--repeats").getIntValue() : 3);
+    const auto filter = args.getValueForOption("--filter");
+
+    const bench::Spec specs[] = {
+        { "small", 64, 64, 32, false, false, false, false },
+        { "medium", 320, 240, 60, false, false, false, false },
+        { "large", 960, 540, 30, false, false, false, false },
+        { "long", 128, 128, 500, false, false, false, false },
+        { "interlaced", 320, 240, 60, true, false, false, false },
+        { "transparent", 320, 240, 60, false, true, false, true },
+        { "localPalettes", 320, 240, 60, false, false, true, false },
+        { "everything", 480, 360, 90, true, true, true, true }
+    };
+
+    const juce::TemporaryFile tempDirectory;
+    const auto tempDir = tempDirectory.getFile();
+    tempDir.createDirectory();
+    juce::Array<juce::var> results;
+    for (const auto& spec : specs)
+        if (filter.isEmpty() || juce::String(spec.name).contains(filter))
+            results.add(bench::run(spec, tempDir, numRepeats));
+    tempDir.deleteRecursively();
+    const auto analysis = filter.isEmpty() || juce::String("analysis").contains(filter) ? bench::runAnalysis(numRepeats) : juce::Array<juce::var>();
+
+    auto report = std::make_unique<juce::DynamicObject>();
+    report->setProperty("label", args.getValueForOption("--label"));
+    report->setProperty("repeats", numRepeats);
+    report->setProperty("cpus", juce::SystemStats::getNumCpus());
+    report->setProperty("results", results);
+    report->setProperty("analysis", analysis);
+    const auto json = juce::JSON::toString(juce::var(report.release()));
+    const auto outFile = args.getValueForOption("--out");
+    if (outFile.isNotEmpty())
+        juce::File::getCurrentWorkingDirectory().getChildFile(outFile).replaceWithText(json);
+    std::cout << json << "\n";
+    return 0;
+}
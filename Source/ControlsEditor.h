@@ -125,14 +125,14 @@ protected:
         Knob::mouseUp(evt);
         viewer.unfreeze();
     }
+    /* previews the image playback shows where the loop starts over, mapped through the same timeline and direction */
     void mouseDrag(const juce::MouseEvent& evt) override {
         Knob::mouseDrag(evt);
-        const auto start = viewer.jif.loopStart;
-        const auto end = viewer.jif.loopEnd;
-        const auto range = static_cast<float>(end - start);
+        auto& jif = viewer.jif;
+        if (jif.empty() || jif.getNumSteps() == 0) return;
         const auto value = param.getValue();
-        const auto imgIdx = (start + static_cast<int>(range * value)) % end;
-        viewer.freeze(imgIdx);
+        const auto position = jif.getPositionAtPhase(value - std::floor(value));
+        viewer.freeze(jif.getIdxAt(position.step));
     }
 };
 
@@ -179,39 +179,133 @@ protected:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Button)
 };
 
+/* switches a bool property of the plugin state */
+struct Toggle :
+    public juce::Component
+{
+    Toggle(const juce::String& name, juce::ValueTree s, const juce::Identifier& prop, const juce::Colour col) :
+        state(s),
+        property(prop),
+        text(name),
+        colour(col)
+    {}
+protected:
+    juce::ValueTree state;
+    juce::Identifier property;
+    juce::String text;
+    juce::Colour colour;
+
+    bool getValue() const { return static_cast<bool>(state.getProperty(property, false)); }
+    void paint(juce::Graphics& g) override {
+        g.setColour(isMouseOver(false) ? colour : colour.withMultipliedAlpha(.5f));
+        g.setFont(12);
+        g.drawFittedText(text + (getValue() ? ": on" : ": off"), getLocalBounds(), juce::Justification::centredLeft, 1, 0);
+    }
+    void mouseUp(const juce::MouseEvent&) override {
+        state.setProperty(property, !getValue(), nullptr);
+        repaint();
+    }
+    void mouseEnter(const juce::MouseEvent&) override { repaint(); }
+    void mouseExit(const juce::MouseEvent&) override { repaint(); }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Toggle)
+};
+
+struct TextButton :
+    public juce::Component
+{
+    TextButton(const juce::String& name, std::function<void()>&& onClk, const juce::Colour col) :
+        onClick(std::move(onClk)),
+        text(name),
+        colour(col)
+    {}
+protected:
+    std::function<void()> onClick;
+    juce::String text;
+    juce::Colour colour;
+
+    void paint(juce::Graphics& g) override {
+        g.setColour(isMouseOver(false) ? colour : colour.withMultipliedAlpha(.5f));
+        g.setFont(12);
+        g.drawFittedText(text, getLocalBounds(), juce::Justification::centredLeft, 1, 0);
+    }
+    void mouseUp(const juce::MouseEvent& evt) override {
+        if (getLocalBounds().contains(evt.getPosition()))
+            onClick();
+    }
+    void mouseEnter(const juce::MouseEvent&) override { repaint(); }
+    void mouseExit(const juce::MouseEvent&) override { repaint(); }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TextButton)
+};
+
 struct LoopRangeParam :
     public juce::Component,
+    public juce::AsyncUpdater,
     public JIFViewerListener
 {
     LoopRangeParam(JIFAudioProcessor& p, JIFViewer& v) :
         juce::Component(),
         processor(p),
         viewer(v),
-        jif(v.jif)
+        jif(v.jif),
+        filmstrip(),
+        filmstripSource()
     {
+        filmstrip.onBuilt = [this]() { triggerAsyncUpdate(); };
+    }
+    ~LoopRangeParam() override {
+        filmstrip.clear();
+        cancelPendingUpdate();
     }
 protected:
     JIFAudioProcessor& processor;
     JIFViewer& viewer;
     jif::JIF& jif;
+    jif::Filmstrip filmstrip;
+    /* the decoded gif the filmstrip shows. it's only there once a gif is loaded completely,
+    until then there is no filmstrip */
+    std::weak_ptr<const jif::Decoded> filmstripSource;
 
-    void viewerUpdated() override { repaint(); }
+    void viewerUpdated() override {
+        /* compares owners, so a gif that was released since can't pass for a new one at the same address */
+        if (filmstripSource.owner_before(jif.decoded) || jif.decoded.owner_before(filmstripSource))
+            rebuildFilmstrip();
+        repaint();
+    }
+    void handleAsyncUpdate() override { repaint(); }
+    void resized() override { rebuildFilmstrip(); }
+    void rebuildFilmstrip() {
+        filmstripSource = jif.decoded;
+        if (jif.decoded == nullptr)
+            filmstrip.clear();
+        else
+            filmstrip.rebuild(jif, getLocalBounds());
+    }
+    /* the filmstrip, or grey while it isn't built, with the loop range and the image that is showing on top of it.
+    it's the same few draws for any number of images */
     void paint(juce::Graphics& g) override {
+        const auto numImages = static_cast<int>(jif.numImages());
+        if (numImages == 0) return;
+        const auto strip = filmstrip.get();
+        if (strip.isValid())
+            g.drawImageAt(strip, 0, 0);
+        else
+            g.fillAll(juce::Colours::grey);
+        g.setColour(juce::Colours::black.withAlpha(.6f));
+        g.fillRect(getArea(0, jif.loopStart));
+        g.fillRect(getArea(jif.loopEnd, numImages));
+        g.setColour(juce::Colours::greenyellow.withAlpha(.7f));
+        const auto playhead = getArea(jif.readIdx, jif.readIdx + 1);
+        g.fillRect(playhead.withSizeKeepingCentre(juce::jmax(2.f, playhead.getWidth()), playhead.getHeight()));
+    }
+    /* where the images from first up to last are on the strip */
+    juce::Rectangle<float> getArea(const int first, const int last) const {
         const auto numImages = static_cast<float>(jif.numImages());
         const auto width = static_cast<float>(getWidth());
-        const auto height = static_cast<float>(getHeight());
-        const auto blockWidth = width / numImages;
-        for (auto i = 0; i < numImages; ++i) {
-            const auto blockX = blockWidth * i;
-            const auto blockArea = juce::Rectangle<float>(blockX, 0.f, blockWidth, height);
-            if (i == jif.readIdx)
-                g.setColour(juce::Colours::greenyellow);
-            else if(i < jif.loopStart || i >= jif.loopEnd)
-                g.setColour(juce::Colours::darkgrey);
-            else
-                g.setColour(juce::Colours::grey);
-            g.fillRect(blockArea);
-        }
+        const auto x = static_cast<float>(first) / numImages * width;
+        const auto right = static_cast<float>(juce::jmax(first, last)) / numImages * width;
+        return { x, 0.f, right - x, static_cast<float>(getHeight()) };
     }
 
     void mouseDrag(const juce::MouseEvent& evt) override {
@@ -224,14 +318,15 @@ protected:
         updateLoopCues(evt.position.x, evt.mods.isLeftButtonDown());
         viewer.unfreeze();
     }
+    /* the strip is divided evenly, so the image under x is arithmetic */
     void updateLoopCues(float x, bool leftButtonDown) {
         const auto numImagesInt = static_cast<int>(jif.numImages());
-        const auto numImages = static_cast<float>(numImagesInt);
-        const auto width = static_cast<float>(getWidth());
+        if (numImagesInt == 0 || getWidth() == 0) return;
+        const auto position = juce::jlimit(0.f, 1.f, x / static_cast<float>(getWidth())) * static_cast<float>(numImagesInt);
         if (leftButtonDown)
-            jif.loopStart = juce::jlimit(0, jif.loopEnd - 1, static_cast<int>(std::floor(x / width * numImages))); 
+            jif.loopStart = juce::jlimit(0, jif.loopEnd - 1, static_cast<int>(std::floor(position)));
         else
-            jif.loopEnd = juce::jlimit(jif.loopStart + 1, numImagesInt, static_cast<int>(std::ceil(x / width * numImages)));
+            jif.loopEnd = juce::jlimit(jif.loopStart + 1, numImagesInt, static_cast<int>(std::ceil(position)));
         auto& state = processor.apvts.state;
         state.setProperty("loopStart", jif.loopStart, nullptr);
         state.setProperty("loopEnd", jif.loopEnd, nullptr);
@@ -240,7 +335,8 @@ protected:
 };
 
 struct ControlsEditor :
-    public juce::Component
+    public juce::Component,
+    public juce::Timer
 {
     ControlsEditor(JIFAudioProcessor& p, JIFViewer& v) :
         processor(p),
@@ -250,10 +346,18 @@ struct ControlsEditor :
         titleLabel("JIF*", 42, mainColour, juce::Justification::centred),
         subTitleLabel("by Florian Mrugalla", 12, mainColour, juce::Justification::centredBottom),
         reloadButton(juce::ImageCache::getFromMemory(BinaryData::loadJIF_png, BinaryData::loadJIF_pngSize), [this]() { viewer.tryLoadWithFileChooser(); }, mainColour),
-        saveWTButton(juce::ImageCache::getFromMemory(BinaryData::saveWT_png, BinaryData::saveWT_pngSize), [this]() { viewer.saveWavetable(); }, mainColour),
+        saveWTButton(juce::ImageCache::getFromMemory(BinaryData::saveWT_png, BinaryData::saveWT_pngSize), [this]() { showExportMenu(); }, mainColour),
+        embedToggle("Embed GIF", p.apvts.state, "embedGif", mainColour),
+        statsToggle("Stats", p.apvts.state, "showStats", mainColour),
+        crossfadeToggle("Crossfade", p.apvts.state, "crossfade", mainColour),
+        logStatsButton("Log stats", [this]() { logStats(); }, mainColour),
+        playlistButton("Playlist", [this]() { showPlaylistMenu(); }, mainColour),
+        playlistChooser(),
         loopRangeParam(p, viewer),
         speedKnob(processor.apvts, param::ID::Speed, mainColour),
         phaseKnob(processor.apvts, param::ID::Phase, mainColour, viewer),
+        directionKnob(processor.apvts, param::ID::Direction, mainColour),
+        syncKnob(processor.apvts, param::ID::Sync, mainColour),
         discord("Discord", "https://discord.gg/xpTGJJNAZG", 12, mainColour),
         github("Github", "https://github.com/Mrugalla", 12, mainColour),
         paypal("Paypal", "https://www.paypal.com/paypalme/alteoma", 12, mainColour)
@@ -266,9 +370,16 @@ struct ControlsEditor :
         addAndMakeVisible(subTitleLabel);
         addAndMakeVisible(reloadButton);
         addAndMakeVisible(saveWTButton);
+        addAndMakeVisible(embedToggle);
+        addAndMakeVisible(statsToggle);
+        addAndMakeVisible(crossfadeToggle);
+        addAndMakeVisible(logStatsButton);
+        addAndMakeVisible(playlistButton);
         addAndMakeVisible(loopRangeParam); viewer.addListener(&loopRangeParam);
         addAndMakeVisible(speedKnob);
         addAndMakeVisible(phaseKnob);
+        addAndMakeVisible(directionKnob);
+        addAndMakeVisible(syncKnob);
         addAndMakeVisible(discord);
         addAndMakeVisible(github);
         addAndMakeVisible(paypal);
@@ -280,9 +391,13 @@ protected:
     juce::Font cFont;
     Label titleLabel, subTitleLabel;
     Button reloadButton, saveWTButton;
+    Toggle embedToggle, statsToggle, crossfadeToggle;
+    TextButton logStatsButton, playlistButton;
+    std::unique_ptr<juce::FileChooser> playlistChooser;
     LoopRangeParam loopRangeParam;
     Knob speedKnob;
     PhaseKnob phaseKnob;
+    Knob directionKnob, syncKnob;
     Link discord, github, paypal;
 
     void paint(juce::Graphics& g) override {
@@ -293,6 +408,79 @@ protected:
         g.setFont(12);
         g.drawFittedText("Build: " + buildDate, getLocalBounds(), juce::Justification::bottomLeft, 1, 0);
         g.drawFittedText("*pronounced with a hard J", getLocalBounds(), juce::Justification::topRight, 1, 0);
+        const auto residentMB = static_cast<double>(viewer.getResidentBytes()) / (1024. * 1024.);
+        const auto& perf = processor.perf;
+        const auto statsStr = viewer.isExporting()
+            ? "exporting: " + juce::String(juce::roundToInt(viewer.getExportProgress() * 100.f)) + "%"
+            : juce::String(residentMB, 1) + " MB, skipped: " + juce::String(perf.framesSkipped.load())
+                + ", late: " + juce::String(perf.vBlanksLate.load());
+        g.drawFittedText(statsStr, getLocalBounds(), juce::Justification::bottomRight, 1, 0);
+    }
+    void showPlaylistMenu() {
+        const auto paths = viewer.getPlaylist();
+        const auto currentIdx = viewer.getPlaylistIndex();
+        juce::PopupMenu menu;
+        for (auto i = 0; i < paths.size(); ++i)
+            menu.addItem(juce::String(i + 1) + ": " + juce::File(paths[i]).getFileNameWithoutExtension(), true, i == currentIdx,
+                [this, i]() { viewer.selectPlaylistEntry(i); });
+        if (!paths.isEmpty())
+            menu.addSeparator();
+        menu.addItem("Add GIFs...", [this]() { addToPlaylist(); });
+        menu.addItem("Remove current", currentIdx != -1, false, [this, paths, currentIdx]() {
+            auto newPaths = paths;
+            newPaths.remove(currentIdx);
+            viewer.setPlaylist(newPaths);
+        });
+        menu.addItem("Clear", !paths.isEmpty(), false, [this]() { viewer.setPlaylist({}); });
+        juce::PopupMenu barsMenu;
+        const auto numBars = viewer.getPlaylistBars();
+        for (const auto bars : { 0, 1, 2, 4, 8, 16 })
+            barsMenu.addItem(bars == 0 ? juce::String("Off") : juce::String(bars) + (bars == 1 ? " bar" : " bars"), true, bars == numBars,
+                [this, bars]() { viewer.setPlaylistBars(bars); });
+        menu.addSubMenu("Switch every", barsMenu);
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&playlistButton));
+    }
+    void addToPlaylist() {
+        const juce::File directory(processor.apvts.state.getProperty("directory", "").toString());
+        playlistChooser = std::make_unique<juce::FileChooser>("Add GIFs to the playlist", directory, "*.gif");
+        const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::canSelectMultipleItems;
+        playlistChooser->launchAsync(flags, [this](const juce::FileChooser& chooser) {
+            auto paths = viewer.getPlaylist();
+            for (const auto& file : chooser.getResults())
+                paths.add(file.getFullPathName());
+            viewer.setPlaylist(paths);
+        });
+    }
+    void showExportMenu() {
+        juce::PopupMenu menu;
+        if (viewer.isExporting())
+            menu.addItem("Cancel export", [this]() { viewer.cancelExport(); });
+        else {
+            const auto addItems = [&](const juce::String& title, wt::Exporter::Mode mode) {
+                menu.addSectionHeader(title);
+                for (const auto cycleLength : wt::cycleLengths)
+                    menu.addItem(juce::String(cycleLength) + " samples per cycle", [this, mode, cycleLength]() {
+                        viewer.saveWavetable({ mode, cycleLength });
+                        startTimerHz(15);
+                    });
+            };
+            addItems("Single file, loop range", wt::Exporter::Mode::SingleFile);
+            addItems("Band-limited octaves, loop range", wt::Exporter::Mode::MipMapped);
+            addItems("One file per image", wt::Exporter::Mode::TablePerImage);
+        }
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&saveWTButton));
+    }
+    /* appends the current measurements to JIFStats.log in the user's log folder, so they can be attached to a report */
+    void logStats() {
+        std::unique_ptr<juce::FileLogger> logger(juce::FileLogger::createDefaultAppLogger("JIF", "JIFStats.log", "JIF stats"));
+        logger->logMessage(processor.perf.toLines().joinIntoString("\n"));
+        logger->getLogFile().revealToUser();
+    }
+    /* keeps the export progress up to date */
+    void timerCallback() override {
+        repaint();
+        if (!viewer.isExporting())
+            stopTimer();
     }
     void resized() override {
         auto thingsCount = 6.f;
@@ -302,16 +490,25 @@ protected:
         auto x = 0.f;
         auto y = 0.f;
         const auto titlesHeight = thingsHeight * 2;
+        embedToggle.setBounds(juce::Rectangle<float>(x, y, width * .25f, thingsHeight * .5f).toNearestInt());
+        statsToggle.setBounds(juce::Rectangle<float>(x, y + thingsHeight * .5f, width * .125f, thingsHeight * .5f).toNearestInt());
+        logStatsButton.setBounds(juce::Rectangle<float>(x + width * .125f, y + thingsHeight * .5f, width * .125f, thingsHeight * .5f).toNearestInt());
+        playlistButton.setBounds(juce::Rectangle<float>(x, y + thingsHeight, width * .25f, thingsHeight * .5f).toNearestInt());
+        crossfadeToggle.setBounds(juce::Rectangle<float>(x, y + thingsHeight * 1.5f, width * .25f, thingsHeight * .5f).toNearestInt());
         titleLabel.setBounds(juce::Rectangle<float>(x, y, width, titlesHeight).toNearestInt());
         subTitleLabel.setBounds(juce::Rectangle<float>(x, y, width, titlesHeight).toNearestInt());
         y += titlesHeight;
         loopRangeParam.setBounds(juce::Rectangle<float>(x, y, width, thingsHeight).toNearestInt());
         y += thingsHeight;
-        const auto knobsWidth = width * .5f;
+        const auto knobsWidth = width / 4.f;
         const auto knobsHeight = thingsHeight * 2;
         speedKnob.setBounds(juce::Rectangle<float>(x, y, knobsWidth, knobsHeight).toNearestInt());
         x += knobsWidth;
         phaseKnob.setBounds(juce::Rectangle<float>(x, y, knobsWidth, knobsHeight).toNearestInt());
+        x += knobsWidth;
+        directionKnob.setBounds(juce::Rectangle<float>(x, y, knobsWidth, knobsHeight).toNearestInt());
+        x += knobsWidth;
+        syncKnob.setBounds(juce::Rectangle<float>(x, y, knobsWidth, knobsHeight).toNearestInt());
         x = 0.f;
         y += knobsHeight;
         const auto buttonsWidth = width / 5.f;
@@ -0,0 +1,124 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "JIF.h"
+#include "Wavetable.h"
+
+/* converts every gif in a directory to wavetables without the plugin.
+each file gets decoded and exported on its own, so as many files are converted at once as there are cores */
+
+namespace converter {
+    struct Settings {
+        juce::File input, output;
+        wt::Exporter::Options options;
+        bool recursive;
+    };
+
+    static void printUsage() {
+        std::cout << "usage: Converter <gif directory> [options]\n"
+            << "  --out <directory>        where the wavetables go, defaults to the gif directory\n"
+            << "  --mode tables|single|octaves\n"
+            << "                           a table per image, one file with a cycle per image (default)\n"
+            << "                           or band-limited octaves\n"
+            << "  --cycle 256|512|1024|2048  samples per cycle, defaults to 2048\n"
+            << "  --recursive              also converts the gifs in subdirectories\n";
+    }
+
+    static bool parse(const juce::StringArray& args, Settings& settings) {
+        if (args.isEmpty())
+            return false;
+        settings.input = juce::File::getCurrentWorkingDirectory().getChildFile(args[0]);
+        settings.output = settings.input;
+        for (auto i = 1; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            if (arg == "--recursive")
+                settings.recursive = true;
+            else if (i + 1 == args.size())
+                return false;
+            else if (arg == "--out")
+                settings.output = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--cycle") {
+                settings.options.cycleLength = args[++i].getIntValue();
+                if (std::find(std::begin(wt::cycleLengths), std::end(wt::cycleLengths), settings.options.cycleLength) == std::end(wt::cycleLengths))
+                    return false;
+            }
+            else if (arg == "--mode") {
+                const auto mode = args[++i];
+                if (mode == "tables")
+                    settings.options.mode = wt::Exporter::Mode::TablePerImage;
+                else if (mode == "single")
+                    settings.options.mode = wt::Exporter::Mode::SingleFile;
+                else if (mode == "octaves")
+                    settings.options.mode = wt::Exporter::Mode::MipMapped;
+                else
+                    return false;
+            }
+            else
+                return false;
+        }
+        return settings.input.isDirectory();
+    }
+
+    static juce::File getDestination(const juce::File& gif, const Settings& settings) {
+        const auto name = gif.getFileNameWithoutExtension() + "_" + juce::String(settings.options.cycleLength);
+        switch (settings.options.mode) {
+        case wt::Exporter::Mode::SingleFile: return settings.output.getChildFile(name + ".wav");
+        case wt::Exporter::Mode::MipMapped: return settings.output.getChildFile(name + "_octaves");
+        default: return settings.output.getChildFile(name);
+        }
+    }
+
+    /* a line of output per file. they get printed as the files finish, so they're serialized */
+    static void convert(const juce::File& gif, const Settings& settings, juce::CriticalSection& printMutex) {
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        juce::MemoryMappedFile mapped(gif, juce::MemoryMappedFile::readOnly);
+        juce::MemoryBlock block;
+        const void* data = mapped.getData();
+        auto size = mapped.getSize();
+        if (data == nullptr && gif.loadFileAsData(block)) {
+            data = block.getData();
+            size = block.getSize();
+        }
+        jif::JIF jif;
+        if (data != nullptr)
+            jif.reload(data, size);
+        const auto decodedMs = juce::Time::getMillisecondCounterHiRes();
+        /* the files are the unit of parallelism already, so an export only needs one of the shared pool's threads */
+        wt::Exporter exporter(1);
+        exporter.exportNow(jif, getDestination(gif, settings), settings.options);
+        const auto exportedMs = juce::Time::getMillisecondCounterHiRes();
+
+        const juce::ScopedLock lock(printMutex);
+        if (jif.empty())
+            std::cout << gif.getFileName() << ": not a gif\n";
+        else
+            std::cout << gif.getFileName() << ": " << jif.numImages() << " images, "
+                << juce::String(decodedMs - startMs, 1) << " ms decode, "
+                << juce::String(exportedMs - decodedMs, 1) << " ms export\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::StringArray args;
+    for (auto i = 1; i < argc; ++i)
+        args.add(argv[i]);
+    converter::Settings settings{ {}, {}, { wt::Exporter::Mode::SingleFile, 2048 }, false };
+    if (!converter::parse(args, settings)) {
+        converter::printUsage();
+        return 1;
+    }
+    settings.output.createDirectory();
+
+    const auto gifs = settings.input.findChildFiles(juce::File::findFiles, settings.recursive, "*.gif");
+    const auto startMs = juce::Time::getMillisecondCounterHiRes();
+    juce::CriticalSection printMutex;
+    {
+        juce::ThreadPool pool(juce::SystemStats::getNumCpus());
+        for (const auto& gif : gifs)
+            pool.addJob([&settings, &printMutex, gif]() { converter::convert(gif, settings, printMutex); });
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(10);
+    }
+    std::cout << gifs.size() << " files in " << juce::String((juce::Time::getMillisecondCounterHiRes() - startMs) * .001, 2) << " s\n";
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace perf {
+    /* min, max, mean and last value of a measurement. it's lock-free and never allocates,
+    so the audio thread can add to it while the message thread reads it */
+    class Meter {
+    public:
+        Meter() :
+            count(0),
+            sum(0.),
+            minimum(std::numeric_limits<double>::max()),
+            maximum(std::numeric_limits<double>::lowest()),
+            last(0.)
+        {}
+        void add(const double value) noexcept {
+            last.store(value, std::memory_order_relaxed);
+            update(sum, [value](const double s) { return s + value; });
+            update(minimum, [value](const double m) { return juce::jmin(m, value); });
+            update(maximum, [value](const double m) { return juce::jmax(m, value); });
+            count.fetch_add(1, std::memory_order_release);
+        }
+        juce::int64 getCount() const noexcept { return count.load(std::memory_order_acquire); }
+        double getLast() const noexcept { return last.load(std::memory_order_relaxed); }
+        double getMin() const noexcept { return getCount() == 0 ? 0. : minimum.load(std::memory_order_relaxed); }
+        double getMax() const noexcept { return getCount() == 0 ? 0. : maximum.load(std::memory_order_relaxed); }
+        double getMean() const noexcept {
+            const auto n = getCount();
+            return n == 0 ? 0. : sum.load(std::memory_order_relaxed) / static_cast<double>(n);
+        }
+        /* last, mean and max */
+        juce::String toString(const int numDecimals = 2) const {
+            return juce::String(getLast(), numDecimals) + " / " + juce::String(getMean(), numDecimals) + " / " + juce::String(getMax(), numDecimals);
+        }
+    private:
+        std::atomic<juce::int64> count;
+        std::atomic<double> sum, minimum, maximum, last;
+
+        template<typename Func>
+        static void update(std::atomic<double>& value, Func&& func) noexcept {
+            auto expected = value.load(std::memory_order_relaxed);
+            while (!value.compare_exchange_weak(expected, func(expected), std::memory_order_relaxed))
+            {
+            }
+        }
+    };
+
+    using Counter = std::atomic<juce::int64>;
+
+    /* what it takes to get a gif from the host's playhead onto the screen */
+    struct Stats {
+        Stats() :
+            vBlankInterval(), vBlankJitter(), paintDuration(), renderLatency(),
+            vBlanks(0), vBlanksLate(0), framesShown(0), framesSkipped(0), framesRepeated(0),
+            blockSize(), blockInterval(), analysisTime(),
+            eventsDropped(0),
+            decodeTime(),
+            residentBytes(0)
+        {}
+        /* in ms, from the message thread. a late vblank kept the previous frame on screen for an extra refresh,
+        a repeated frame is a vblank that kept a frame on screen for longer than its delay lasts at the tempo */
+        Meter vBlankInterval, vBlankJitter, paintDuration, renderLatency;
+        Counter vBlanks, vBlanksLate, framesShown, framesSkipped, framesRepeated;
+        /* from the audio thread, in samples, ms and µs. dropped events didn't fit into the queues to the viewer */
+        Meter blockSize, blockInterval, analysisTime;
+        Counter eventsDropped;
+        /* per load, in ms */
+        Meter decodeTime;
+        std::atomic<juce::int64> residentBytes;
+
+        /* a line per measurement, for the overlay and the log. not for the audio thread */
+        juce::StringArray toLines() const {
+            juce::StringArray lines;
+            lines.add("ms: last / mean / max");
+            lines.add("vblank interval: " + vBlankInterval.toString());
+            lines.add("vblank jitter: " + vBlankJitter.toString());
+            lines.add("paint: " + paintDuration.toString());
+            lines.add("block to render: " + renderLatency.toString());
+            lines.add("block interval: " + blockInterval.toString());
+            lines.add("block size: " + blockSize.toString(0) + " samples");
+            lines.add("input analysis: " + analysisTime.toString(1) + " us, dropped events: " + juce::String(eventsDropped.load()));
+            lines.add("frames shown: " + juce::String(framesShown.load()) + ", skipped: " + juce::String(framesSkipped.load())
+                + ", repeated: " + juce::String(framesRepeated.load()));
+            lines.add("vblanks: " + juce::String(vBlanks.load()) + ", late: " + juce::String(vBlanksLate.load()));
+            lines.add("decode: " + decodeTime.toString(1));
+            lines.add("resident: " + juce::String(static_cast<double>(residentBytes.load()) / (1024. * 1024.), 1) + " MB");
+            return lines;
+        }
+    };
+}
@@ -1,44 +1,272 @@
 #pragma once
 #include <JuceHeader.h>
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
 
 namespace jif {
+    using Palette = std::array<juce::PixelARGB, 256>;
+
+    /* row kernels that expand palette indices to ARGB, leaving the transparent index's pixels alone.
+    the palette is opaque, so its colours are premultiplied already */
+    namespace kernel {
+        using ExpandRow = void(*)(const juce::uint8* src, juce::PixelARGB* dest, int num, const Palette& pal, int transparent);
+
+        inline void expandRowScalar(const juce::uint8* src, juce::PixelARGB* dest, const int num, const Palette& pal, const int transparent) {
+            for (auto i = 0; i < num; ++i)
+                if (src[i] != transparent)
+                    dest[i] = pal[src[i]];
+        }
+        /* crossfades two rows, which works for every pixel format as long as both are premultiplied.
+        alpha goes from 0 (all a) to maxAlpha (all b), the kernels only take what's in between */
+        static constexpr int maxAlpha = 128;
+        using BlendRow = void(*)(const juce::uint8* a, const juce::uint8* b, juce::uint8* dest, int numBytes, int alpha);
+
+        inline void blendRowScalar(const juce::uint8* a, const juce::uint8* b, juce::uint8* dest, const int numBytes, const int alpha) noexcept {
+            for (auto i = 0; i < numBytes; ++i)
+                dest[i] = static_cast<juce::uint8>((a[i] * (maxAlpha - alpha) + b[i] * alpha) >> 7);
+        }
+#if JUCE_INTEL
+ #if JUCE_GCC || JUCE_CLANG
+  #define JIF_TARGET(isa) __attribute__((target(isa)))
+ #else
+  #define JIF_TARGET(isa)
+ #endif
+        JIF_TARGET("avx2") inline void expandRowAVX2(const juce::uint8* src, juce::PixelARGB* dest, const int num, const Palette& pal, const int transparent) {
+            const auto table = reinterpret_cast<const int*>(pal.data());
+            const auto transparentIdx = _mm256_set1_epi32(transparent);
+            auto i = 0;
+            for (; i + 8 <= num; i += 8) {
+                const auto idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+                const auto colours = _mm256_i32gather_epi32(table, idx, 4);
+                const auto keep = _mm256_cmpeq_epi32(idx, transparentIdx);
+                const auto d = reinterpret_cast<__m256i*>(dest + i);
+                _mm256_storeu_si256(d, _mm256_blendv_epi8(colours, _mm256_loadu_si256(d), keep));
+            }
+            expandRowScalar(src + i, dest + i, num - i, pal, transparent);
+        }
+        JIF_TARGET("sse4.1") inline void expandRowSSE41(const juce::uint8* src, juce::PixelARGB* dest, const int num, const Palette& pal, const int transparent) {
+            const auto table = reinterpret_cast<const int*>(pal.data());
+            const auto transparentIdx = _mm_set1_epi32(transparent);
+            auto i = 0;
+            for (; i + 4 <= num; i += 4) {
+                const auto idx = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(juce::ByteOrder::littleEndianInt(src + i))));
+                const auto colours = _mm_setr_epi32(table[src[i]], table[src[i + 1]], table[src[i + 2]], table[src[i + 3]]);
+                const auto keep = _mm_cmpeq_epi32(idx, transparentIdx);
+                const auto d = reinterpret_cast<__m128i*>(dest + i);
+                _mm_storeu_si128(d, _mm_blendv_epi8(colours, _mm_loadu_si128(d), keep));
+            }
+            expandRowScalar(src + i, dest + i, num - i, pal, transparent);
+        }
+        /* interleaves the bytes of a and b, so one multiply-add weighs a pair of them. the weights are 7 bits to fit into signed bytes */
+        JIF_TARGET("avx2") inline void blendRowAVX2(const juce::uint8* a, const juce::uint8* b, juce::uint8* dest, const int numBytes, const int alpha) noexcept {
+            const auto weights = _mm256_set1_epi16(static_cast<short>(alpha << 8 | (maxAlpha - alpha)));
+            auto i = 0;
+            for (; i + 32 <= numBytes; i += 32) {
+                const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                const auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                const auto lo = _mm256_srli_epi16(_mm256_maddubs_epi16(_mm256_unpacklo_epi8(x, y), weights), 7);
+                const auto hi = _mm256_srli_epi16(_mm256_maddubs_epi16(_mm256_unpackhi_epi8(x, y), weights), 7);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_packus_epi16(lo, hi));
+            }
+            blendRowScalar(a + i, b + i, dest + i, numBytes - i, alpha);
+        }
+        JIF_TARGET("ssse3") inline void blendRowSSSE3(const juce::uint8* a, const juce::uint8* b, juce::uint8* dest, const int numBytes, const int alpha) noexcept {
+            const auto weights = _mm_set1_epi16(static_cast<short>(alpha << 8 | (maxAlpha - alpha)));
+            auto i = 0;
+            for (; i + 16 <= numBytes; i += 16) {
+                const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                const auto lo = _mm_srli_epi16(_mm_maddubs_epi16(_mm_unpacklo_epi8(x, y), weights), 7);
+                const auto hi = _mm_srli_epi16(_mm_maddubs_epi16(_mm_unpackhi_epi8(x, y), weights), 7);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packus_epi16(lo, hi));
+            }
+            blendRowScalar(a + i, b + i, dest + i, numBytes - i, alpha);
+        }
+  #undef JIF_TARGET
+#endif
+        /* picks the widest kernel the cpu supports, once */
+        inline ExpandRow getExpandRow() {
+            static const ExpandRow expandRow = []() -> ExpandRow {
+#if JUCE_INTEL
+                if (juce::SystemStats::hasAVX2())
+                    return expandRowAVX2;
+                if (juce::SystemStats::hasSSE41())
+                    return expandRowSSE41;
+#endif
+                return expandRowScalar;
+            }();
+            return expandRow;
+        }
+
+        inline BlendRow getBlendRow() {
+            static const BlendRow blendRow = []() -> BlendRow {
+#if JUCE_INTEL
+                if (juce::SystemStats::hasAVX2())
+                    return blendRowAVX2;
+                if (juce::SystemStats::hasSSSE3())
+                    return blendRowSSSE3;
+#endif
+                return blendRowScalar;
+            }();
+            return blendRow;
+        }
+    }
+
+    /* blends area of a and b into dest, which gets reallocated only if it doesn't match a's size and format.
+    a and b have to be of the same size and format. rows in which they are the same are skipped,
+    so only the returned areas of dest hold the blend */
+    inline juce::RectangleList<int> crossfade(const juce::Image& a, const juce::Image& b, juce::Image& dest, const juce::Rectangle<int>& area, const float amount) {
+        if (dest.getBounds() != a.getBounds() || dest.getFormat() != a.getFormat())
+            dest = juce::Image(a.getFormat(), a.getWidth(), a.getHeight(), false, juce::SoftwareImageType());
+        const auto clipped = area.getIntersection(a.getBounds());
+        const auto alpha = juce::jlimit(0, kernel::maxAlpha, juce::roundToInt(amount * static_cast<float>(kernel::maxAlpha)));
+        if (clipped.isEmpty() || alpha == 0)
+            return {};
+        const juce::Image::BitmapData dataA(a, clipped.getX(), clipped.getY(), clipped.getWidth(), clipped.getHeight(), juce::Image::BitmapData::readOnly);
+        const juce::Image::BitmapData dataB(b, clipped.getX(), clipped.getY(), clipped.getWidth(), clipped.getHeight(), juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData dataDest(dest, clipped.getX(), clipped.getY(), clipped.getWidth(), clipped.getHeight(), juce::Image::BitmapData::writeOnly);
+        const auto numBytes = clipped.getWidth() * dataA.pixelStride;
+        const auto rowsDiffer = [&](const int y) {
+            return std::memcmp(dataA.getLinePointer(y), dataB.getLinePointer(y), static_cast<size_t>(numBytes)) != 0;
+        };
+        const auto blendRow = kernel::getBlendRow();
+        juce::RectangleList<int> blendedArea;
+        for (auto y = 0; y < clipped.getHeight(); ++y) {
+            if (!rowsDiffer(y)) continue;
+            const auto first = y;
+            for (; y < clipped.getHeight() && rowsDiffer(y); ++y)
+                if (alpha == kernel::maxAlpha)
+                    std::memcpy(dataDest.getLinePointer(y), dataB.getLinePointer(y), static_cast<size_t>(numBytes));
+                else
+                    blendRow(dataA.getLinePointer(y), dataB.getLinePointer(y), dataDest.getLinePointer(y), numBytes, alpha);
+            blendedArea.addWithoutMerging({ clipped.getX(), clipped.getY() + first, clipped.getWidth(), y - first });
+        }
+        return blendedArea;
+    }
+
+    /* what happens to an image's area before the next image is drawn */
+    enum class Disposal { Unspecified, Keep, Background, Previous };
+
+    /* a frame as the gif stores it: 8 bit palette indices plus the palette and transparent index they refer to.
+    it only gets expanded to ARGB when composited */
     struct Image {
         Image() :
-            image(),
+            indices(),
+            palette(),
+            transparent(-1),
+            delay(0),
+            disposal(Disposal::Unspecified),
             x(0),
             y(0),
             width(0),
             height(0)
         {}
-        Image(const juce::Image&& img) :
-            image(img),
+        Image(const juce::Image&& idxImg, std::shared_ptr<const Palette> pal, const int transparentIdx) :
+            indices(idxImg),
+            palette(pal),
+            transparent(transparentIdx),
+            delay(0),
+            disposal(Disposal::Unspecified),
             x(0),
             y(0),
-            width(static_cast<float>(img.getWidth())),
-            height(static_cast<float>(img.getHeight()))
+            width(static_cast<float>(idxImg.getWidth())),
+            height(static_cast<float>(idxImg.getHeight()))
         {}
-        void paint(juce::Graphics& g, const juce::Rectangle<float>& bounds) {
-            const auto nX = x * bounds.getWidth();
-            const auto nY = y * bounds.getHeight();
-            const auto nWidth = width * bounds.getWidth();
-            const auto nHeight = height * bounds.getHeight();
-            g.drawImage(image, { nX, nY, nWidth, nHeight });
+        bool isValid() const noexcept { return indices.isValid() && palette != nullptr; }
+        /* the delay in 1/100 s, with the usual fallback for gifs that say 0 or 1 */
+        int getDelay() const noexcept { return delay < 2 ? 10 : delay; }
+        juce::Rectangle<float> getNormalizedArea() const noexcept { return { x, y, width, height }; }
+        /* the area the image covers on a canvas of the logical screen's size */
+        juce::Rectangle<int> getArea(const juce::Image& canvas) const {
+            const auto left = juce::roundToInt(x * static_cast<float>(canvas.getWidth()));
+            const auto top = juce::roundToInt(y * static_cast<float>(canvas.getHeight()));
+            return juce::Rectangle<int>(left, top, indices.getWidth(), indices.getHeight())
+                .getIntersection(canvas.getBounds());
+        }
+        /* expands the indices onto canvas, which is ARGB and has the size of the logical screen */
+        void paint(juce::Image& canvas) const {
+            const auto area = getArea(canvas);
+            if (area.isEmpty()) return;
+            const auto left = juce::roundToInt(x * static_cast<float>(canvas.getWidth()));
+            const auto top = juce::roundToInt(y * static_cast<float>(canvas.getHeight()));
+            const juce::Image::BitmapData srcData(indices, juce::Image::BitmapData::readOnly);
+            const juce::Image::BitmapData destData(canvas, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                juce::Image::BitmapData::readWrite);
+            const auto& pal = *palette;
+            const auto expandRow = kernel::getExpandRow();
+            for (auto row = 0; row < destData.height; ++row) {
+                const auto src = srcData.getPixelPointer(area.getX() - left, area.getY() - top + row);
+                const auto dest = reinterpret_cast<juce::PixelARGB*>(destData.getLinePointer(row));
+                expandRow(src, dest, destData.width, pal, transparent);
+            }
+        }
+        /* maps the pixel position and size to the logical screen of the gif */
+        void normalize(const float screenWidth, const float screenHeight) noexcept {
+            x /= screenWidth;
+            y /= screenHeight;
+            width /= screenWidth;
+            height /= screenHeight;
         }
-        juce::Image image;
+        size_t getResidentBytes() const {
+            if (!indices.isValid()) return 0;
+            const juce::Image::BitmapData data(indices, juce::Image::BitmapData::readOnly);
+            return static_cast<size_t>(data.lineStride * data.height);
+        }
+        juce::Image indices;
+        std::shared_ptr<const Palette> palette;
+        int transparent, delay;
+        Disposal disposal;
         float x, y, width, height;
     };
 
+    /* bounds checked cursor over the bytes of a gif */
+    class ByteReader {
+    public:
+        ByteReader(const void* data, const size_t size) noexcept :
+            pos(static_cast<const juce::uint8*>(data)),
+            end(static_cast<const juce::uint8*>(data) + size)
+        {}
+        /* returns the number of bytes that were actually read */
+        int read(void* dest, const int numBytes) noexcept {
+            const auto n = juce::jmin(static_cast<size_t>(numBytes), getNumBytesRemaining());
+            if (n == 0)
+                return 0;
+            std::memcpy(dest, pos, n);
+            pos += n;
+            return static_cast<int>(n);
+        }
+        /* skips the next numBytes and returns where they are, or nullptr if there aren't that many left */
+        const juce::uint8* take(const int numBytes) noexcept {
+            if (static_cast<size_t>(numBytes) > getNumBytesRemaining())
+                return nullptr;
+            const auto p = pos;
+            pos += numBytes;
+            return p;
+        }
+        size_t getNumBytesRemaining() const noexcept { return static_cast<size_t>(end - pos); }
+        const juce::uint8* getPosition() const noexcept { return pos; }
+    private:
+        const juce::uint8* pos;
+        const juce::uint8* end;
+    };
+
     class Format
     {
         struct Loader
         {
-            Loader(juce::InputStream& in) :
+            Loader(const void* data, const size_t size) :
                 image(),
                 bgColour(0xff000000),
-                input(in),
+                globalPalette(),
+                screenWidth(0), screenHeight(0),
+                imageData(nullptr), imageDataSize(0), interlaced(false),
+                input(data, size),
                 dataBlockIsZero(false), fresh(false), finished(false),
                 imageWidth(0), imageHeight(0), transparent(-1), numColours(0),
-                currentBit(0), lastBit(0), lastByteIndex(0),
+                delay(0), disposal(0),
+                block(nullptr),
+                bitBuffer(0), numBits(0), blockPos(0), blockEnd(0),
                 codeSize(0), setCodeSize(0), maxCode(0), maxCodeSize(0),
                 firstcode(0), oldcode(0), clearCode(0), endCode(0),
                 sp(nullptr)
@@ -56,14 +284,19 @@ namespace jif {
                 if ((buf[0] & 0x80) == 0)
                     return false;
 
-                readPalette();
+                globalPalette = readPalette();
+
+                screenWidth = imageWidth;
+                screenHeight = imageHeight;
 
                 const auto bgColourIdx = buf[1];
-                bgColour = juce::Colour(palette[bgColourIdx]);
+                bgColour = juce::Colour((*globalPalette)[bgColourIdx]);
                 return true;
             }
 
-            void loadAnotherImage() {
+            /* returns false if there was no other image left in the stream.
+            without shouldDecode the image only gets indexed, so that decodeImageData can decompress it later */
+            bool loadAnotherImage(const bool shouldDecode = true) {
                 for (;;) {
                     if (input.read(buf, 1) != 1 || buf[0] == ';') break;
 
@@ -83,40 +316,67 @@ namespace jif {
 
                         numColours = 2 << (buf[8] & 7);
 
+                        auto palette = globalPalette;
                         if ((buf[8] & 0x80) != 0)
-                            readPalette();
+                            palette = readPalette();
 
-                        const auto pxlFormat = transparent >= 0 ? juce::Image::ARGB : juce::Image::RGB;
-                        image = juce::Image(pxlFormat, imageWidth, imageHeight, transparent >= 0);
+                        image = Image(shouldDecode ? juce::Image(juce::Image::SingleChannel, imageWidth, imageHeight, true) : juce::Image(), palette, transparent);
                         image.x = static_cast<float>(imageX);
                         image.y = static_cast<float>(imageY);
-
-                        image.image.getProperties()->set("originalImageHadAlpha", transparent >= 0);
-
-                        readImage((buf[8] & 0x40) != 0);
+                        image.width = static_cast<float>(imageWidth);
+                        image.height = static_cast<float>(imageHeight);
+                        image.delay = delay;
+                        image.disposal = disposal < 4 ? static_cast<Disposal>(disposal) : Disposal::Unspecified;
+                        interlaced = (buf[8] & 0x40) != 0;
+
+                        if (shouldDecode)
+                            readImage(interlaced);
+                        else if (!skipImage())
+                            return false;
+
+                        // a graphic control extension only applies to the image that follows it
+                        transparent = -1;
+                        delay = disposal = 0;
+                        return true;
                     }
 
                     break;
                 }
+                return false;
+            }
+
+            /* decompresses img's lzw data, which this loader got constructed with, into img.indices */
+            bool decodeImageData(Image& img, const bool isInterlaced) {
+                image = std::move(img);
+                const auto result = readImage(isInterlaced);
+                img = std::move(image);
+                return result;
             }
 
             Image image;
             juce::Colour bgColour;
+            std::shared_ptr<const Palette> globalPalette;
+            int screenWidth, screenHeight;
+            /* the lzw data of the last image, from its code size byte to its block terminator */
+            const juce::uint8* imageData;
+            size_t imageDataSize;
+            bool interlaced;
         private:
-            juce::InputStream& input;
-            
+            ByteReader input;
+
             bool dataBlockIsZero, fresh, finished;
             int imageWidth, imageHeight, transparent, numColours;
-            int currentBit, lastBit, lastByteIndex;
+            int delay, disposal;
+            const juce::uint8* block;
+            juce::uint64 bitBuffer;
+            int numBits, blockPos, blockEnd;
             int codeSize, setCodeSize;
             int maxCode, maxCodeSize;
             int firstcode, oldcode;
             int clearCode, endCode;
             enum { maxGifCode = 1 << 12 };
             int* sp;
-            juce::uint8 buffer[260];
             juce::uint8 buf[16];
-            juce::PixelARGB palette[256];
             int table[2][maxGifCode];
             int stack[2 * maxGifCode];
 
@@ -136,21 +396,26 @@ namespace jif {
                 return false;
             }
 
-            void readPalette() {
+            std::shared_ptr<const Palette> readPalette() {
+                auto palette = std::make_shared<Palette>();
+                palette->fill(juce::PixelARGB(0xff, 0, 0, 0));
                 for (int i = 0; i < numColours; ++i) {
-                    juce::uint8 rgb[4];
-                    input.read(rgb, 3);
-                    palette[i].setARGB(0xff, rgb[0], rgb[1], rgb[2]);
-                    palette[i].premultiply();
+                    const auto rgb = input.take(3);
+                    if (rgb == nullptr)
+                        break;
+                    (*palette)[i].setARGB(0xff, rgb[0], rgb[1], rgb[2]);
                 }
+                return palette;
             }
 
-            int readDataBlock(juce::uint8* const dest) {
+            /* points dest at the next sub-block, which stays where it is in the gif's bytes */
+            int readDataBlock(const juce::uint8*& dest) {
                 juce::uint8 n;
                 if (input.read(&n, 1) == 1) {
                     dataBlockIsZero = (n == 0);
+                    dest = input.take(n);
 
-                    if (dataBlockIsZero || (input.read(dest, n) == n))
+                    if (dataBlockIsZero || dest != nullptr)
                         return n;
                 }
 
@@ -162,7 +427,7 @@ namespace jif {
                 if (input.read(&type, 1) != 1)
                     return false;
 
-                juce::uint8 b[260];
+                const juce::uint8* b = nullptr;
                 int n = 0;
 
                 if (type == 0xf9) {
@@ -170,8 +435,12 @@ namespace jif {
                     if (n < 0)
                         return 1;
 
-                    if ((b[0] & 1) != 0)
-                        transparent = b[3];
+                    if (n >= 4) {
+                        if ((b[0] & 1) != 0)
+                            transparent = b[3];
+                        disposal = (b[0] >> 2) & 7;
+                        delay = (int)juce::ByteOrder::littleEndianShort(b + 1);
+                    }
                 }
 
                 do {
@@ -181,6 +450,21 @@ namespace jif {
                 return n >= 0;
             }
 
+            bool skipImage() {
+                imageData = input.getPosition();
+                if (input.take(1) == nullptr)
+                    return false;
+
+                const juce::uint8* b = nullptr;
+                int n;
+                while ((n = readDataBlock(b)) > 0)
+                {
+                }
+
+                imageDataSize = static_cast<size_t>(input.getPosition() - imageData);
+                return n == 0;
+            }
+
             void clearTable()
             {
                 int i;
@@ -248,7 +532,7 @@ namespace jif {
                         if (dataBlockIsZero)
                             return -2;
 
-                        juce::uint8 buff[260];
+                        const juce::uint8* buff = nullptr;
                         int n;
 
                         while ((n = readDataBlock(buff)) > 0)
@@ -300,44 +584,47 @@ namespace jif {
                 return code;
             }
 
+            /* pulls the next code out of a 64 bit accumulator that gets refilled from the sub-blocks */
             int getCode(const int codeSize_, const bool shouldInitialise)
             {
                 if (shouldInitialise)
                 {
-                    currentBit = 0;
-                    lastBit = 0;
+                    bitBuffer = 0;
+                    numBits = 0;
+                    blockPos = blockEnd = 0;
                     finished = false;
                     return 0;
                 }
 
-                if ((currentBit + codeSize_) >= lastBit)
+                while (numBits < codeSize_)
                 {
-                    if (finished)
-                        return -1;
-
-                    buffer[0] = buffer[lastByteIndex - 2];
-                    buffer[1] = buffer[lastByteIndex - 1];
-
-                    const int n = readDataBlock(buffer + 2);
+                    if (blockPos == blockEnd)
+                    {
+                        if (finished)
+                            return -1;
 
-                    if (n == 0)
-                        finished = true;
+                        const int n = readDataBlock(block);
 
-                    lastByteIndex = 2 + n;
-                    currentBit = (currentBit - lastBit) + 16;
-                    lastBit = (2 + n) * 8;
-                }
+                        if (n <= 0)
+                        {
+                            finished = true;
+                            return -1;
+                        }
 
-                int result = 0;
-                int i = currentBit;
+                        blockPos = 0;
+                        blockEnd = n;
+                    }
 
-                for (int j = 0; j < codeSize_; ++j)
-                {
-                    result |= ((buffer[i >> 3] & (1 << (i & 7))) != 0) << j;
-                    ++i;
+                    while (numBits <= 56 && blockPos < blockEnd)
+                    {
+                        bitBuffer |= static_cast<juce::uint64>(block[blockPos++]) << numBits;
+                        numBits += 8;
+                    }
                 }
 
-                currentBit += codeSize_;
+                const int result = static_cast<int>(bitBuffer & ((1u << codeSize_) - 1));
+                bitBuffer >>= codeSize_;
+                numBits -= codeSize_;
                 return result;
             }
 
@@ -348,24 +635,17 @@ namespace jif {
 
                 initialise(c);
 
-                if (transparent >= 0)
-                    palette[transparent].setARGB(0, 0, 0, 0);
-
                 int xpos = 0, ypos = 0, yStep = 8, pass = 0;
 
-                const juce::Image::BitmapData destData(image.image, juce::Image::BitmapData::writeOnly);
+                const juce::Image::BitmapData destData(image.indices, juce::Image::BitmapData::writeOnly);
                 juce::uint8* p = destData.getPixelPointer(0, 0);
-                const bool hasAlpha = image.image.hasAlphaChannel();
 
                 for (;;) {
                     const int index = readLZWByte();
                     if (index < 0)
                         break;
 
-                    if (hasAlpha)
-                        ((juce::PixelARGB*)p)->set(palette[index]);
-                    else
-                        ((juce::PixelRGB*)p)->set(palette[index]);
+                    *p = static_cast<juce::uint8>(index);
 
                     p += destData.pixelStride;
 
@@ -400,89 +680,320 @@ namespace jif {
             JUCE_DECLARE_NON_COPYABLE(Loader)
         };
     public:
-        bool valid(juce::InputStream& in) {
+        /* decodes straight from the bytes, which have to outlive the Format */
+        bool valid(const void* data, const size_t size) {
 #if (JUCE_MAC || JUCE_IOS) && USE_COREGRAPHICS_RENDERING && JUCE_USE_COREIMAGE_LOADER
             return false;
 #else
-            loader = std::make_unique<Loader>(in);
+            loader = std::make_unique<Loader>(data, size);
             return loader->readHeader();
 #endif
         }
+        /* for sources that aren't in memory yet */
+        bool valid(juce::InputStream& in) {
+            streamData.reset();
+            in.readIntoMemoryBlock(streamData);
+            return valid(streamData.getData(), streamData.getSize());
+        }
 
-        Image decodeImage() {
-            loader->loadAnotherImage();
-            return loader->image;
+        /* returns false if the stream has no images left */
+        bool decodeImage(Image& img) {
+            if (!loader->loadAnotherImage())
+                return false;
+            img = loader->image;
+            img.normalize(static_cast<float>(loader->screenWidth), static_cast<float>(loader->screenHeight));
+            return true;
         };
 
+        /* an image whose lzw data hasn't been decompressed yet.
+        it only points into the gif's bytes, so those have to outlive it */
+        struct Frame {
+            Image image;
+            int width, height;
+            bool interlaced;
+            const juce::uint8* data;
+            size_t size;
+        };
+
+        /* like decodeImage, but only indexes the image, which is a lot faster.
+        the frames of a gif can then be decoded independently of each other */
+        bool scanImage(Frame& frame) {
+            if (!loader->loadAnotherImage(false))
+                return false;
+            frame.image = loader->image;
+            frame.width = static_cast<int>(frame.image.width);
+            frame.height = static_cast<int>(frame.image.height);
+            frame.interlaced = loader->interlaced;
+            frame.data = loader->imageData;
+            frame.size = loader->imageDataSize;
+            frame.image.normalize(static_cast<float>(loader->screenWidth), static_cast<float>(loader->screenHeight));
+            return true;
+        }
+
+        /* thread safe, as every frame gets its own lzw tables */
+        static bool decodeFrame(Frame& frame) {
+            if (frame.width <= 0 || frame.height <= 0)
+                return false;
+            frame.image.indices = juce::Image(juce::Image::SingleChannel, frame.width, frame.height, true);
+            auto frameLoader = std::make_unique<Loader>(frame.data, frame.size);
+            return frameLoader->decodeImageData(frame.image, frame.interlaced);
+        }
+
         juce::Colour getBackgroundColour() { return loader->bgColour; }
+        int getWidth() const noexcept { return loader->screenWidth; }
+        int getHeight() const noexcept { return loader->screenHeight; }
 
         std::unique_ptr<Loader> loader;
+        juce::MemoryBlock streamData;
+    };
+
+    /* composites the images of a gif onto a canvas of its logical screen size.
+    the canvas gets copied every keyframeInterval images, so any image can be reached within keyframeInterval draws */
+    class Compositor {
+    public:
+        static constexpr int keyframeInterval = 16;
+
+        /* Sequential keeps no keyframes, for walking through the images once in order.
+        going backwards then composites everything up to the image again */
+        enum class Access { Random, Sequential };
+
+        Compositor(const Access a = Access::Random) :
+            canvas(),
+            previous(),
+            keyframes(),
+            bgColour(0x00000000),
+            canvasIdx(-1),
+            access(a),
+            disposalPending(false)
+        {}
+        void clear() {
+            canvas = previous = juce::Image();
+            keyframes.clear();
+            canvasIdx = -1;
+            disposalPending = false;
+        }
+        /* returns the canvas with all images up to and including idx drawn onto it */
+        const juce::Image& getFrame(const std::vector<Image>& images, const int width, const int height, const juce::Colour bg, const int idx) {
+            if (!canvas.isValid() || canvas.getWidth() != width || canvas.getHeight() != height || bgColour != bg)
+                reset(width, height, bg);
+            if (idx == canvasIdx)
+                return canvas;
+            const auto keyed = access == Access::Random;
+            const auto keyIdx = keyed ? juce::jmin(idx / keyframeInterval, static_cast<int>(keyframes.size()) - 1) : 0;
+            const auto keyStart = keyIdx * keyframeInterval;
+            if (canvasIdx > idx || canvasIdx < keyStart - 1) {
+                if (keyed)
+                    copyPixels(keyframes[keyIdx], canvas, {});
+                else
+                    canvas.clear(canvas.getBounds(), bgColour);
+                canvasIdx = keyStart - 1;
+                disposalPending = false;
+            }
+            for (auto i = canvasIdx + 1; i <= idx; ++i) {
+                if (disposalPending)
+                    dispose(images[i - 1]);
+                if (keyed && i % keyframeInterval == 0 && i / keyframeInterval == static_cast<int>(keyframes.size()))
+                    keyframes.push_back(canvas.createCopy());
+                if (images[i].disposal == Disposal::Previous)
+                    previous = canvas.getClippedImage(images[i].getArea(canvas)).createCopy();
+                images[i].paint(canvas);
+                disposalPending = true;
+            }
+            canvasIdx = idx;
+            return canvas;
+        }
+        size_t getResidentBytes() const noexcept {
+            const auto frameBytes = static_cast<size_t>(canvas.getWidth() * canvas.getHeight() * 4);
+            return frameBytes * (canvas.isValid() ? keyframes.size() + 1 : 0);
+        }
+    private:
+        juce::Image canvas, previous;
+        std::vector<juce::Image> keyframes;
+        juce::Colour bgColour;
+        int canvasIdx;
+        Access access;
+        bool disposalPending;
+
+        /* keyframes hold the canvas after the previous image got disposed, so restoring one never leaves a disposal pending */
+        void dispose(const Image& img) {
+            const auto area = img.getArea(canvas);
+            if (img.disposal == Disposal::Background)
+                canvas.clear(area, bgColour);
+            else if (img.disposal == Disposal::Previous && previous.isValid())
+                copyPixels(previous, canvas, area.getPosition());
+        }
+
+        void reset(const int width, const int height, const juce::Colour bg) {
+            bgColour = bg;
+            canvas = juce::Image(juce::Image::ARGB, juce::jmax(1, width), juce::jmax(1, height), false);
+            canvas.clear(canvas.getBounds(), bgColour);
+            keyframes.clear();
+            if (access == Access::Random)
+                keyframes.push_back(canvas.createCopy());
+            canvasIdx = -1;
+            disposalPending = false;
+        }
+        static void copyPixels(const juce::Image& src, juce::Image& dest, const juce::Point<int>& destPos) {
+            const auto area = src.getBounds().withPosition(destPos).getIntersection(dest.getBounds());
+            if (area.isEmpty()) return;
+            const juce::Image::BitmapData srcData(src, juce::Image::BitmapData::readOnly);
+            const juce::Image::BitmapData destData(dest, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                juce::Image::BitmapData::writeOnly);
+            const auto numBytes = static_cast<size_t>(destData.width * destData.pixelStride);
+            for (auto y = 0; y < destData.height; ++y)
+                std::memcpy(destData.getLinePointer(y), srcData.getLinePointer(y), numBytes);
+        }
+    };
+
+    enum class Direction { Forward, Reverse, PingPong };
+
+    /* a decoded gif. it's immutable once decoded, so plugin instances can share it */
+    struct Decoded {
+        std::vector<Image> images;
+        juce::Colour bgColour;
+        int width, height;
+    };
+
+    /* process-wide cache of decoded gifs, keyed by a hash of their bytes.
+    it only holds them weakly, so a gif is gone as soon as the last instance lets go of it */
+    class Cache {
+    public:
+        Cache() :
+            mutex(),
+            entries()
+        {}
+        std::shared_ptr<const Decoded> find(const juce::uint64 key) {
+            const juce::ScopedLock lock(mutex);
+            removeExpired();
+            const auto it = entries.find(key);
+            return it != entries.end() ? it->second.lock() : nullptr;
+        }
+        /* returns the gif that is in the cache already, if another instance was faster */
+        std::shared_ptr<const Decoded> insert(const juce::uint64 key, std::shared_ptr<const Decoded> decoded) {
+            const juce::ScopedLock lock(mutex);
+            removeExpired();
+            auto& entry = entries[key];
+            if (auto existing = entry.lock())
+                return existing;
+            entry = decoded;
+            return decoded;
+        }
+        /* XXH64 over the raw bytes of a gif. it takes 32 bytes per step, so hashing isn't what makes a cache hit slow */
+        static juce::uint64 getKey(const void* data, const size_t size) noexcept {
+            static constexpr juce::uint64 p1 = 11400714785074694791ull, p2 = 14029467366897019727ull, p3 = 1609587929392839161ull,
+                p4 = 9650029242287828579ull, p5 = 2870177450012600261ull;
+            const auto rotl = [](const juce::uint64 x, const int r) { return (x << r) | (x >> (64 - r)); };
+            const auto round = [&](const juce::uint64 acc, const juce::uint64 input) { return rotl(acc + input * p2, 31) * p1; };
+            const auto merge = [&](const juce::uint64 acc, const juce::uint64 v) { return (acc ^ round(0, v)) * p1 + p4; };
+            auto p = static_cast<const juce::uint8*>(data);
+            const auto end = p + size;
+            juce::uint64 hash = p5;
+            if (size >= 32) {
+                juce::uint64 v1 = p1 + p2, v2 = p2, v3 = 0, v4 = 0 - p1;
+                for (; p + 32 <= end; p += 32) {
+                    v1 = round(v1, juce::ByteOrder::littleEndianInt64(p));
+                    v2 = round(v2, juce::ByteOrder::littleEndianInt64(p + 8));
+                    v3 = round(v3, juce::ByteOrder::littleEndianInt64(p + 16));
+                    v4 = round(v4, juce::ByteOrder::littleEndianInt64(p + 24));
+                }
+                hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+                hash = merge(merge(merge(merge(hash, v1), v2), v3), v4);
+            }
+            hash += static_cast<juce::uint64>(size);
+            for (; p + 8 <= end; p += 8)
+                hash = rotl(hash ^ round(0, juce::ByteOrder::littleEndianInt64(p)), 27) * p1 + p4;
+            if (p + 4 <= end) {
+                hash = rotl(hash ^ (static_cast<juce::uint64>(juce::ByteOrder::littleEndianInt(p)) * p1), 23) * p2 + p3;
+                p += 4;
+            }
+            for (; p < end; ++p)
+                hash = rotl(hash ^ (*p * p5), 11) * p1;
+            hash = (hash ^ (hash >> 33)) * p2;
+            hash = (hash ^ (hash >> 29)) * p3;
+            return hash ^ (hash >> 32);
+        }
+    private:
+        juce::CriticalSection mutex;
+        std::map<juce::uint64, std::weak_ptr<const Decoded>> entries;
+
+        void removeExpired() {
+            for (auto it = entries.begin(); it != entries.end();)
+                it = it->second.expired() ? entries.erase(it) : std::next(it);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Cache)
     };
 
     struct JIF {
         JIF() :
             images(),
+            decoded(),
+            timeline(),
+            compositor(),
             bgColour(0x00000000),
+            direction(Direction::Forward),
+            width(0),
+            height(0),
             readIdx(0),
             lastReadIdx(-1),
             loopStart(0),
             loopEnd(0),
-            startIdx(0)
+            startIdx(0),
+            playStep(0),
+            blendIdx(0),
+            blend(0.f)
         {
         }
         JIF(const void* jifData, const size_t jifSize) :
             images(),
+            decoded(),
+            timeline(),
+            compositor(),
             bgColour(0x00000000),
+            direction(Direction::Forward),
+            width(0),
+            height(0),
             readIdx(0),
             lastReadIdx(0),
             loopStart(0),
             loopEnd(0),
-            startIdx(0)
+            startIdx(0),
+            playStep(0),
+            blendIdx(0),
+            blend(0.f)
         { reload(jifData, jifSize); }
         void reload(const void* jifData, const size_t jifSize) {
-            images.clear();
-            juce::MemoryInputStream memoryInputStream(jifData, jifSize, true);
+            clear();
             Format format;
-            if (format.valid(memoryInputStream)) {
-                bgColour = format.getBackgroundColour();
-                while (!memoryInputStream.isExhausted()) {
-                    const auto img = format.decodeImage();
-                    if (img.image.isValid())
-                        images.push_back(img);
-                }
-            }
-            else return;
-            auto maxWidth = 0.f;
-            auto maxHeight = 0.f;
-            for (const auto& img : images) {
-                const auto w = img.image.getWidth();
-                const auto h = img.image.getHeight();
-                maxWidth = maxWidth < w ? w : maxWidth;
-                maxHeight = maxHeight < h ? h : maxHeight;
-            }
-
-            for (auto& img : images) {
-                img.x /= maxWidth;
-                img.y /= maxHeight;
-                img.width /= maxWidth;
-                img.height /= maxHeight;
-            }
-            
-            loopStart = startIdx = 0;
-            loopEnd = numImages();
+            if (!format.valid(jifData, jifSize))
+                return;
+            bgColour = format.getBackgroundColour();
+            width = format.getWidth();
+            height = format.getHeight();
+            Image img;
+            while (format.decodeImage(img))
+                if (img.isValid())
+                    images.push_back(img);
+            loopEnd = static_cast<int>(numImages());
+        }
+        void clear() {
+            images.clear();
+            decoded.reset();
+            timeline.clear();
+            compositor.clear();
+            bgColour = juce::Colour(0x00000000);
+            width = height = 0;
+            readIdx = 0;
             lastReadIdx = -1;
+            loopStart = loopEnd = startIdx = 0;
+            playStep = 0;
+            blendIdx = 0;
+            blend = 0.f;
         }
         const size_t numImages() const noexcept { return images.size(); }
         void paint(juce::Graphics& g, const juce::Rectangle<float>& bounds) {
             if (!images.empty()) {
-                if (lastReadIdx < readIdx)
-                    for (auto i = lastReadIdx + 1; i <= readIdx; ++i)
-                        images[i].paint(g, bounds);
-                else if (lastReadIdx > readIdx) {
-                    g.fillAll(bgColour);
-                    for (auto i = 0; i <= readIdx; ++i)
-                        images[i].paint(g, bounds);
-                }
+                g.drawImage(getFrame(readIdx), bounds);
                 lastReadIdx = readIdx;
                 return;
             }
@@ -490,30 +1001,773 @@ namespace jif {
             g.setColour(juce::Colours::white);
             g.drawFittedText("Click here\nto import a\nJIF!", bounds.toNearestInt(), juce::Justification::centred, 1);
         }
-        void operator++() { ++readIdx; if (readIdx >= loopEnd) readIdx = loopStart; }
+        /* the loop range clamped to the images that are already there, so a gif can play while it's still loading */
+        int getLoopStart() const noexcept { return juce::jmax(0, juce::jmin(loopStart, getLoopEnd() - 1)); }
+        int getLoopEnd() const noexcept { return juce::jmin(loopEnd, static_cast<int>(numImages())); }
+        /* the fully composited image at idx */
+        const juce::Image& getFrame(const int idx) {
+            const auto i = juce::jlimit(0, static_cast<int>(numImages()) - 1, idx);
+            return compositor.getFrame(images, width, height, bgColour, i);
+        }
+        /* number of steps it takes to play the loop once in the current direction */
+        int getNumSteps() const noexcept {
+            const auto range = getLoopEnd() - getLoopStart();
+            if (direction == Direction::PingPong && range > 1)
+                return 2 * range - 2;
+            return range;
+        }
+        int getIdxAt(const int step) const noexcept {
+            const auto start = getLoopStart();
+            const auto range = getLoopEnd() - start;
+            switch (direction) {
+            case Direction::Reverse: return start + range - 1 - step;
+            case Direction::PingPong: return start + (step < range ? step : 2 * range - 2 - step);
+            default: return start + step;
+            }
+        }
+        /* a step of the loop and how much of its image's delay has passed */
+        struct Position {
+            int step;
+            float fraction;
+        };
+        /* maps a phase of the loop to a step through the timeline, so every image lasts as long as its delay says.
+        O(log n) */
+        Position getPositionAtPhase(const float phase) {
+            updateTimeline();
+            const auto start = getLoopStart();
+            const auto end = getLoopEnd();
+            const auto range = end - start;
+            const auto forwardLength = timeline[end] - timeline[start];
+            switch (direction) {
+            case Direction::Reverse: {
+                const auto t = timeline[end] - phase * forwardLength;
+                const auto idx = getIdxBackwards(start, end, t);
+                return { start + range - 1 - idx, getFraction(idx, timeline[idx + 1] - t) };
+            }
+            case Direction::PingPong: {
+                const auto backwardLength = end - start > 2 ? timeline[end - 1] - timeline[start + 1] : 0;
+                const auto elapsed = phase * static_cast<float>(forwardLength + backwardLength);
+                if (elapsed < forwardLength || backwardLength == 0) {
+                    const auto t = timeline[start] + elapsed;
+                    const auto idx = getIdxForwards(start, end, t);
+                    return { idx - start, getFraction(idx, t - timeline[idx]) };
+                }
+                const auto t = timeline[end - 1] - (elapsed - forwardLength);
+                const auto idx = getIdxBackwards(start + 1, end - 1, t);
+                return { 2 * range - 2 - (idx - start), getFraction(idx, timeline[idx + 1] - t) };
+            }
+            default: {
+                const auto t = timeline[start] + phase * forwardLength;
+                const auto idx = getIdxForwards(start, end, t);
+                return { idx - start, getFraction(idx, t - timeline[idx]) };
+            }
+            }
+        }
+        /* how much of the loop's duration image idx lasts each time it's shown, from 0 to 1 */
+        float getShareOfLoop(const int idx) {
+            updateTimeline();
+            const auto start = getLoopStart();
+            const auto end = getLoopEnd();
+            if (idx < start || idx >= end)
+                return 0.f;
+            auto length = timeline[end] - timeline[start];
+            if (direction == Direction::PingPong && end - start > 2)
+                length += timeline[end - 1] - timeline[start + 1];
+            return length > 0 ? static_cast<float>(timeline[idx + 1] - timeline[idx]) / static_cast<float>(length) : 0.f;
+        }
+        /* how many steps playback takes from image a to image b in the current direction */
+        int getStepsBetween(const int a, const int b) const noexcept {
+            const auto range = getLoopEnd() - getLoopStart();
+            if (range <= 0) return 0;
+            switch (direction) {
+            case Direction::Reverse: return ((a - b) % range + range) % range;
+            case Direction::PingPong: return std::abs(b - a);
+            default: return ((b - a) % range + range) % range;
+            }
+        }
+        void operator++() {
+            if (empty()) return;
+            const auto numSteps = getNumSteps();
+            playStep = numSteps > 0 ? (playStep + 1) % numSteps : 0;
+            readIdx = getIdxAt(playStep);
+        }
         void resetAnimation() { readIdx = 0; }
-        /* returns true if should repaint (readIdx != newReadIdx && numImages() != 0) */
+        /* plays on from step of the loop, the first one by default. returns true if that's another image */
+        bool restart(const int step = 0) noexcept {
+            const auto numSteps = getNumSteps();
+            if (empty() || numSteps == 0) return false;
+            playStep = juce::jlimit(0, numSteps - 1, step);
+            return setFrameTo(getIdxAt(playStep));
+        }
+        /* how far playback got towards the step after playStep, for when the steps get counted instead of following the timeline */
+        void setBlend(const float amount) noexcept {
+            const auto numSteps = getNumSteps();
+            if (numSteps == 0) return;
+            blendIdx = getIdxAt((playStep + 1) % numSteps);
+            blend = amount;
+        }
+        /* the normalized area in which the composited images a and b can differ.
+        only the images between them and a's disposal touch the canvas, so this works in both directions and across loop wraps */
+        juce::Rectangle<float> getChangedArea(int a, int b) const {
+            static constexpr int maxSteps = 64;
+            const juce::Rectangle<float> everything(0.f, 0.f, 1.f, 1.f);
+            const auto n = static_cast<int>(numImages());
+            if (a < 0 || b < 0 || a >= n || b >= n)
+                return everything;
+            if (a > b)
+                std::swap(a, b);
+            if (b - a > maxSteps)
+                return everything;
+            juce::Rectangle<float> area;
+            if (images[a].disposal == Disposal::Background || images[a].disposal == Disposal::Previous)
+                area = images[a].getNormalizedArea();
+            for (auto i = a + 1; i <= b; ++i)
+                area = area.getUnion(images[i].getNormalizedArea());
+            return area;
+        }
+        /* returns true if should repaint (readIdx != newReadIdx && numImages() != 0).
+        the part of the image's delay that has passed goes to blend */
         bool setFrameTo(float phase, const float offset) noexcept {
-            if (numImages() == 0) return false;
-            const auto range = static_cast<float>(loopEnd - loopStart);
-            phase = loopStart + (phase + offset) * range;
-            while (phase >= loopEnd) phase -= range;
-            const auto newReadIdx = static_cast<int>(phase);
+            const auto numSteps = getNumSteps();
+            if (numSteps == 0) return false;
+            phase += offset;
+            phase -= std::floor(phase);
+            const auto position = getPositionAtPhase(phase);
+            const auto newReadIdx = getIdxAt(position.step);
+            blendIdx = getIdxAt((position.step + 1) % numSteps);
+            blend = position.fraction;
             if (readIdx == newReadIdx) return false;
             readIdx = newReadIdx;
             return true;
         }
         bool setFrameTo(const int imgIdx) noexcept {
+            blend = 0.f;
             const bool changed = readIdx != imgIdx;
             if(changed)
                 readIdx = imgIdx;
             return changed;
         }
         const bool empty() const noexcept { return images.empty(); }
+        /* the memory it takes to hold the decoded gif, including the compositor's canvas and keyframes */
+        size_t getResidentBytes() const { return compositor.getResidentBytes() + getImageBytes(); }
+        /* the images and their palettes. it walks all of them, so it's for when a gif is done loading, not for every paint */
+        size_t getImageBytes() const {
+            size_t numBytes = 0;
+            std::vector<const Palette*> palettes;
+            for (const auto& img : images) {
+                numBytes += img.getResidentBytes();
+                const auto pal = img.palette.get();
+                if (std::find(palettes.begin(), palettes.end(), pal) == palettes.end())
+                    palettes.push_back(pal);
+            }
+            return numBytes + palettes.size() * sizeof(Palette);
+        }
+
+        std::vector<Image> images;
+        /* keeps the shared images alive, while loop range, read index etc. stay with this instance */
+        std::shared_ptr<const Decoded> decoded;
+        /* prefix sum of the delays: timeline[i] is when image i starts, in 1/100 s */
+        std::vector<int> timeline;
+        Compositor compositor;
+        juce::Colour bgColour;
+        Direction direction;
+        int width, height;
+        int readIdx, lastReadIdx, loopStart, loopEnd, startIdx, playStep;
+        /* the image playback is heading to next and how close it is, from 0 to 1 */
+        int blendIdx;
+        float blend;
+    private:
+        float getFraction(const int idx, const float elapsed) const noexcept {
+            const auto delay = timeline[idx + 1] - timeline[idx];
+            return delay > 0 ? juce::jlimit(0.f, 1.f, elapsed / static_cast<float>(delay)) : 0.f;
+        }
+        /* images only ever get appended while loading, so the timeline just has to catch up */
+        void updateTimeline() {
+            if (timeline.size() > numImages() + 1)
+                timeline.clear();
+            if (timeline.empty())
+                timeline.push_back(0);
+            while (timeline.size() <= numImages())
+                timeline.push_back(timeline.back() + images[timeline.size() - 1].getDelay());
+        }
+        /* the image that is shown at time t when playing first to last */
+        int getIdxForwards(const int first, const int last, const float t) const {
+            const auto it = std::upper_bound(timeline.begin() + first, timeline.begin() + last + 1, t);
+            return juce::jlimit(first, last - 1, static_cast<int>(it - timeline.begin()) - 1);
+        }
+        /* the image that is shown at time t when playing last to first */
+        int getIdxBackwards(const int first, const int last, const float t) const {
+            const auto it = std::lower_bound(timeline.begin() + first, timeline.begin() + last + 1, t);
+            return juce::jlimit(first, last - 1, static_cast<int>(it - timeline.begin()) - 1);
+        }
+    };
+
+    /* keeps the composited frames already resampled to the size they are displayed at, so painting them is just a blit.
+    it gets built on a background thread and stops taking frames once the budget all instances share is used up */
+    class ScaledCache :
+        public juce::Thread
+    {
+    public:
+        /* the bytes the frames of all instances hold together */
+        struct Budget {
+            static constexpr size_t maxBytes = 256 * 1024 * 1024;
+
+            Budget() :
+                numBytes(0)
+            {}
+            /* returns false if n more bytes don't fit */
+            bool reserve(const size_t n) noexcept {
+                auto used = numBytes.load();
+                do {
+                    if (used + n > maxBytes)
+                        return false;
+                } while (!numBytes.compare_exchange_weak(used, used + n));
+                return true;
+            }
+            void release(const size_t n) noexcept { numBytes -= n; }
+
+            std::atomic<size_t> numBytes;
+        };
+
+        ScaledCache() :
+            juce::Thread("JIF Scaled Cache"),
+            budget(),
+            mutex(),
+            frames(),
+            images(),
+            bgColour(0x00000000),
+            width(0), height(0),
+            size(),
+            numBytes(0)
+        {}
+        ~ScaledCache() override { clear(); }
+        void clear() {
+            stopThread(4000);
+            const juce::ScopedLock lock(mutex);
+            frames.clear();
+            budget->release(numBytes);
+            numBytes = 0;
+        }
+        /* throws away the cached frames and starts scaling jif's frames to bounds in the background */
+        void rebuild(const JIF& jif, const juce::Rectangle<int>& bounds) {
+            clear();
+            if (jif.empty() || bounds.isEmpty())
+                return;
+            images = jif.images;
+            bgColour = jif.bgColour;
+            width = jif.width;
+            height = jif.height;
+            {
+                const juce::ScopedLock lock(mutex);
+                size = bounds.withZeroOrigin();
+                frames.resize(images.size());
+            }
+            startThread();
+        }
+        /* the frame at the size the cache was built for, or an invalid image if it isn't cached (yet) */
+        juce::Image get(const int idx) const {
+            const juce::ScopedLock lock(mutex);
+            if (idx < 0 || idx >= static_cast<int>(frames.size()))
+                return {};
+            return frames[idx];
+        }
+        juce::Rectangle<int> getSize() const {
+            const juce::ScopedLock lock(mutex);
+            return size;
+        }
+        size_t getResidentBytes() const {
+            const juce::ScopedLock lock(mutex);
+            return numBytes;
+        }
+    private:
+        juce::SharedResourcePointer<Budget> budget;
+        juce::CriticalSection mutex;
+        std::vector<juce::Image> frames;
+        std::vector<Image> images;
+        juce::Colour bgColour;
+        int width, height;
+        juce::Rectangle<int> size;
+        size_t numBytes;
+
+        void run() override {
+            Compositor compositor(Compositor::Access::Sequential);
+            const auto target = size.toFloat();
+            const auto frameBytes = static_cast<size_t>(size.getWidth()) * static_cast<size_t>(size.getHeight()) * 3;
+            for (auto i = 0; i < static_cast<int>(images.size()) && !threadShouldExit(); ++i) {
+                if (!budget->reserve(frameBytes))
+                    return;
+                juce::Image scaled(juce::Image::RGB, size.getWidth(), size.getHeight(), false, juce::SoftwareImageType());
+                {
+                    juce::Graphics g{ scaled };
+                    g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+                    g.drawImage(compositor.getFrame(images, width, height, bgColour, i), target);
+                }
+                const juce::ScopedLock lock(mutex);
+                frames[i] = scaled;
+                numBytes += frameBytes;
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(ScaledCache)
+    };
+
+    /* thumbnails of a gif's images side by side, for picking loop points. slot t of the strip shows the first of the images
+    that fall into it, so x / width * numImages is the image under x. it gets built on a background thread,
+    so drawing it is a single blit however many images there are */
+    class Filmstrip :
+        public juce::Thread
+    {
+    public:
+        Filmstrip() :
+            juce::Thread("JIF Filmstrip"),
+            onBuilt(),
+            mutex(),
+            strip(),
+            images(),
+            bgColour(0x00000000),
+            width(0), height(0),
+            size()
+        {}
+        ~Filmstrip() override { stopThread(4000); }
+        void clear() {
+            stopThread(4000);
+            images.clear();
+            const juce::ScopedLock lock(mutex);
+            strip = juce::Image();
+        }
+        /* throws away the strip and starts rendering jif's images into one of bounds' size */
+        void rebuild(const JIF& jif, const juce::Rectangle<int>& bounds) {
+            clear();
+            images = jif.images;
+            bgColour = jif.bgColour;
+            width = jif.width;
+            height = jif.height;
+            size = bounds.withZeroOrigin();
+            if (images.empty() || size.isEmpty() || width <= 0 || height <= 0)
+                return;
+            startThread();
+        }
+        /* returns an invalid image until the strip is built */
+        juce::Image get() const {
+            const juce::ScopedLock lock(mutex);
+            return strip;
+        }
 
+        /* gets called from the filmstrip's thread once the strip is built */
+        std::function<void()> onBuilt;
+    private:
+        juce::CriticalSection mutex;
+        juce::Image strip;
         std::vector<Image> images;
         juce::Colour bgColour;
-        int readIdx, lastReadIdx, loopStart, loopEnd, startIdx;
+        int width, height;
+        juce::Rectangle<int> size;
+
+        void run() override {
+            const auto numImages = static_cast<int>(images.size());
+            const auto thumbWidth = juce::jmax(1, size.getHeight() * width / height);
+            const auto numThumbs = juce::jlimit(1, numImages, (size.getWidth() + thumbWidth - 1) / thumbWidth);
+            juce::Image built(juce::Image::RGB, size.getWidth(), size.getHeight(), true, juce::SoftwareImageType());
+            {
+                Compositor compositor(Compositor::Access::Sequential);
+                juce::Graphics g{ built };
+                g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+                for (auto t = 0; t < numThumbs && !threadShouldExit(); ++t) {
+                    const auto x = t * size.getWidth() / numThumbs;
+                    const auto right = (t + 1) * size.getWidth() / numThumbs;
+                    const auto idx = t * numImages / numThumbs;
+                    const juce::Rectangle<int> thumb(x, 0, right - x, size.getHeight());
+                    g.drawImage(compositor.getFrame(images, width, height, bgColour, idx), thumb.toFloat());
+                }
+            }
+            if (threadShouldExit())
+                return;
+            {
+                const juce::ScopedLock lock(mutex);
+                strip = built;
+            }
+            if (onBuilt)
+                onBuilt();
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Filmstrip)
+    };
+
+    /* the thread pool decoding and exporting run on. all instances share it, so there's a thread per core however many are open */
+    struct SharedPool :
+        public juce::ThreadPool
+    {
+        SharedPool() :
+            juce::ThreadPool(juce::SystemStats::getNumCpus())
+        {}
+    };
+
+    /* the jobs one owner put on the shared pool. other instances' jobs run there as well,
+    so an owner can only count, wait for and cancel its own. the jobs share their state with it,
+    so the ones that got cancelled before they started can still skip themselves once it's gone */
+    class PoolJobs {
+    public:
+        PoolJobs() :
+            pool(),
+            state(std::make_shared<State>())
+        {}
+        ~PoolJobs() { cancel(); }
+        void add(std::function<void()>&& job) {
+            int generation;
+            {
+                const std::lock_guard<std::mutex> lock(state->mutex);
+                ++state->numQueued;
+                generation = state->generation;
+            }
+            pool->addJob([s = state, generation, j = std::move(job)]() {
+                {
+                    const std::lock_guard<std::mutex> lock(s->mutex);
+                    if (generation != s->generation)
+                        return;
+                    --s->numQueued;
+                    ++s->numRunning;
+                }
+                j();
+                const std::lock_guard<std::mutex> lock(s->mutex);
+                --s->numRunning;
+                s->changed.notify_all();
+            });
+        }
+        /* the ones that are queued or running */
+        int getNumJobs() const {
+            const std::lock_guard<std::mutex> lock(state->mutex);
+            return state->numQueued + state->numRunning;
+        }
+        int getNumThreads() const { return pool->getNumThreads(); }
+        void waitForAll() const {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->changed.wait(lock, [this]() { return state->numQueued + state->numRunning == 0; });
+        }
+        /* the jobs that didn't start yet never will, so this only waits for the ones that are running */
+        void cancel() {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            ++state->generation;
+            state->numQueued = 0;
+            state->changed.notify_all();
+            state->changed.wait(lock, [this]() { return state->numRunning == 0; });
+        }
+    private:
+        struct State {
+            State() :
+                mutex(),
+                changed(),
+                numQueued(0), numRunning(0),
+                generation(0)
+            {}
+            std::mutex mutex;
+            std::condition_variable changed;
+            int numQueued, numRunning;
+            /* goes up with every cancel, jobs from an older one don't run */
+            int generation;
+        };
+        juce::SharedResourcePointer<SharedPool> pool;
+        std::shared_ptr<State> state;
+
+        JUCE_DECLARE_NON_COPYABLE(PoolJobs)
+    };
+
+    /* decodes a gif on a background thread and hands its images out as soon as they are decoded */
+    class AsyncLoader :
+        public juce::Thread
+    {
+    public:
+        enum class Status { Idle, Loading, Finished };
+
+        AsyncLoader() :
+            juce::Thread("JIF Loader"),
+            onImage(),
+            file(),
+            gzipped(),
+            mutex(),
+            cache(),
+            jobs(),
+            frameMutex(),
+            frameDecoded(),
+            loaded(),
+            decoded(),
+            bgColour(0x00000000),
+            width(0), height(0),
+            numCollected(0),
+            decodeMs(0.),
+            status(Status::Idle)
+        {}
+        ~AsyncLoader() override { cancel(); }
+        /* cancels the current load, if there is one */
+        void load(const juce::File& f) {
+            cancel();
+            file = f;
+            gzipped.reset();
+            start();
+        }
+        /* loads a gif that got gzipped by the Compressor, without touching the disk */
+        void load(const juce::MemoryBlock& gzippedGif) {
+            cancel();
+            file = juce::File();
+            gzipped = gzippedGif;
+            start();
+        }
+        bool isLoading() {
+            const juce::ScopedLock lock(mutex);
+            return status != Status::Idle;
+        }
+        /* how long decoding the last gif took, without reading and hashing it. 0 if it came from the cache */
+        double getDecodeMs() {
+            const juce::ScopedLock lock(mutex);
+            return decodeMs;
+        }
+        /* the frames that are decoding get finished, the queued ones are dropped */
+        void cancel() {
+            signalThreadShouldExit();
+            jobs.cancel();
+            {
+                const std::lock_guard<std::mutex> lock(frameMutex);
+                frameDecoded.notify_all();
+            }
+            stopThread(4000);
+            const juce::ScopedLock lock(mutex);
+            loaded.clear();
+            decoded.reset();
+            numCollected = 0;
+            status = Status::Idle;
+        }
+        /* appends the images that were decoded since the last call to jif.
+        once the gif is complete, the whole image vector gets swapped in and Finished is returned (once) */
+        Status collect(JIF& jif) {
+            const juce::ScopedLock lock(mutex);
+            if (status == Status::Idle)
+                return status;
+            jif.bgColour = bgColour;
+            jif.width = width;
+            jif.height = height;
+            if (status == Status::Finished) {
+                jif.images.swap(loaded);
+                jif.decoded = std::move(decoded);
+                loaded.clear();
+                numCollected = 0;
+                status = Status::Idle;
+                return Status::Finished;
+            }
+            for (auto i = numCollected; i < loaded.size(); ++i)
+                jif.images.push_back(loaded[i]);
+            numCollected = loaded.size();
+            return Status::Loading;
+        }
+
+        /* gets called from the loader thread whenever an image was decoded */
+        std::function<void()> onImage;
+    private:
+        juce::File file;
+        juce::MemoryBlock gzipped;
+        juce::CriticalSection mutex;
+        juce::SharedResourcePointer<Cache> cache;
+        PoolJobs jobs;
+        /* guards which frames are done, for handing them out in order */
+        std::mutex frameMutex;
+        std::condition_variable frameDecoded;
+        std::vector<Image> loaded;
+        std::shared_ptr<const Decoded> decoded;
+        juce::Colour bgColour;
+        int width, height;
+        size_t numCollected;
+        double decodeMs;
+        Status status;
+
+        void start() {
+            {
+                const juce::ScopedLock lock(mutex);
+                loaded.clear();
+                decoded.reset();
+                numCollected = 0;
+                decodeMs = 0.;
+                status = Status::Loading;
+            }
+            startThread();
+        }
+        /* for when the file can't be mapped, and for the gzipped gif from the plugin state */
+        bool readSource(juce::MemoryBlock& block) {
+            if (file != juce::File())
+                return file.loadFileAsData(block);
+            juce::MemoryInputStream gzippedStream(gzipped, false);
+            juce::GZIPDecompressorInputStream decompressor(gzippedStream);
+            decompressor.readIntoMemoryBlock(block);
+            return block.getSize() != 0;
+        }
+        void run() override {
+            /* files get decoded straight from the page cache instead of being copied first */
+            std::unique_ptr<juce::MemoryMappedFile> mapped;
+            juce::MemoryBlock block;
+            const void* data = nullptr;
+            size_t size = 0;
+            if (file != juce::File()) {
+                mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+                data = mapped->getData();
+                size = mapped->getSize();
+            }
+            if (data == nullptr && readSource(block)) {
+                data = block.getData();
+                size = block.getSize();
+            }
+            if (data != nullptr && size != 0) {
+                const auto key = Cache::getKey(data, size);
+                if (!takeFromCache(key)) {
+                    const auto startMs = juce::Time::getMillisecondCounterHiRes();
+                    decode(data, size, key);
+                    const juce::ScopedLock lock(mutex);
+                    decodeMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+                }
+            }
+            if (threadShouldExit())
+                return;
+            {
+                const juce::ScopedLock lock(mutex);
+                status = Status::Finished;
+            }
+            if (onImage)
+                onImage();
+        }
+        bool takeFromCache(const juce::uint64 key) {
+            const auto cached = cache->find(key);
+            if (cached == nullptr)
+                return false;
+            const juce::ScopedLock lock(mutex);
+            loaded = cached->images;
+            bgColour = cached->bgColour;
+            width = cached->width;
+            height = cached->height;
+            decoded = cached;
+            return true;
+        }
+        void decode(const void* data, const size_t size, const juce::uint64 key) {
+            Format format;
+            if (format.valid(data, size)) {
+                {
+                    const juce::ScopedLock lock(mutex);
+                    bgColour = format.getBackgroundColour();
+                    width = format.getWidth();
+                    height = format.getHeight();
+                }
+                /* every image's lzw stream is self-contained, so index them all first,
+                decompress them on the pool and hand them out in order as they complete */
+                std::vector<Format::Frame> frames;
+                Format::Frame frame;
+                while (!threadShouldExit() && format.scanImage(frame))
+                    frames.push_back(frame);
+                std::vector<bool> done(frames.size(), false);
+                for (size_t i = 0; i < frames.size() && !threadShouldExit(); ++i)
+                    jobs.add([this, &frames, &done, i]() {
+                        Format::decodeFrame(frames[i]);
+                        const std::lock_guard<std::mutex> lock(frameMutex);
+                        done[i] = true;
+                        frameDecoded.notify_all();
+                    });
+                for (size_t i = 0; i < frames.size(); ++i) {
+                    {
+                        std::unique_lock<std::mutex> lock(frameMutex);
+                        frameDecoded.wait(lock, [this, &done, i]() { return done[i] || threadShouldExit(); });
+                    }
+                    if (threadShouldExit())
+                        break;
+                    if (frames[i].image.isValid()) {
+                        {
+                            const juce::ScopedLock lock(mutex);
+                            loaded.push_back(frames[i].image);
+                        }
+                        if (onImage)
+                            onImage();
+                    }
+                }
+                /* the jobs refer to frames and done. after a cancel only the ones that were running are left */
+                jobs.waitForAll();
+            }
+            if (threadShouldExit())
+                return;
+            const juce::ScopedLock lock(mutex);
+            if (loaded.empty())
+                return;
+            decoded = cache->insert(key, std::make_shared<const Decoded>(Decoded{ loaded, bgColour, width, height }));
+            loaded = decoded->images;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(AsyncLoader)
+    };
+
+    /* gzips a gif file for embedding it in the plugin state. it works on a background thread a chunk at a time,
+    so cancelling it never waits for a whole file to be compressed */
+    class Compressor :
+        public juce::Thread
+    {
+    public:
+        static constexpr size_t chunkSize = 1 << 20;
+
+        Compressor() :
+            juce::Thread("JIF Compressor"),
+            onCompressed(),
+            file(),
+            mutex(),
+            compressed()
+        {}
+        ~Compressor() override { cancel(); }
+        /* cancels the current compression, if there is one */
+        void compress(const juce::File& f) {
+            cancel();
+            file = f;
+            startThread();
+        }
+        void cancel() {
+            stopThread(4000);
+            const juce::ScopedLock lock(mutex);
+            compressed.reset();
+        }
+        /* the gzipped bytes once they're done, empty before */
+        juce::MemoryBlock take() {
+            const juce::ScopedLock lock(mutex);
+            juce::MemoryBlock data;
+            data.swapWith(compressed);
+            return data;
+        }
+
+        /* gets called from the compressor's thread once the file is gzipped */
+        std::function<void()> onCompressed;
+    private:
+        juce::File file;
+        juce::CriticalSection mutex;
+        juce::MemoryBlock compressed;
+
+        void run() override {
+            juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+            juce::MemoryBlock block;
+            auto data = static_cast<const char*>(mapped.getData());
+            auto size = mapped.getSize();
+            if (data == nullptr) {
+                if (!file.loadFileAsData(block))
+                    return;
+                data = static_cast<const char*>(block.getData());
+                size = block.getSize();
+            }
+            juce::MemoryBlock gzippedGif;
+            {
+                juce::MemoryOutputStream out(gzippedGif, false);
+                juce::GZIPCompressorOutputStream zipper(out);
+                for (size_t i = 0; i < size; i += chunkSize) {
+                    if (threadShouldExit())
+                        return;
+                    zipper.write(data + i, juce::jmin(chunkSize, size - i));
+                }
+            }
+            {
+                const juce::ScopedLock lock(mutex);
+                compressed.swapWith(gzippedGif);
+            }
+            if (onCompressed)
+                onCompressed();
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Compressor)
     };
 }
 
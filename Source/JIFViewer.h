@@ -1,6 +1,8 @@
 #pragma once
 #include <JuceHeader.h>
 #include "JIF.h"
+#include "Playlist.h"
+#include "Wavetable.h"
 
 struct JIFViewerListener {
     virtual void viewerUpdated() = 0;
@@ -8,168 +10,599 @@ struct JIFViewerListener {
 
 struct JIFViewer :
     public juce::Component,
-    public juce::Timer,
-    public juce::AsyncUpdater
+    public juce::AsyncUpdater,
+    public juce::ValueTree::Listener
 {
     JIFViewer(JIFAudioProcessor& p) :
         jif(),
         processor(p),
+        loader(),
+        compressor(),
+        scaledCache(),
+        playlist(),
+        exporter(),
+        listeners(),
+        pendingMidi(),
+        fileChooser(),
         cFont(),
         bounds(0,0,0,0),
-        fps(0), speedValue(420)
-    { setOpaque(true); }
+        cacheBounds(),
+        vBlank(this, [this]() { onVBlank(); }),
+        perf(p.perf),
+        fps(0), speedValue(420), audioEnvelope(0.f),
+        lastVBlankMs(0.), vBlankIntervalMs(0.), freeRunSteps(0.), loadStartMs(0.),
+        vBlanksShown(0),
+        imageBytes(0),
+        repaintedIdx(-1), repaintedBlendIdx(0), repaintedAlpha(0),
+        blended(),
+        playlistTarget(-1), lastEntryParam(static_cast<int>(p.entry->load())), lastBarIdx(-1),
+        statsShown(false),
+        thumbnail(false),
+        embedding(static_cast<bool>(p.apvts.state.getProperty("embedGif", false))),
+        frozen(false),
+        loopFollowsLoad(false),
+        stateReplaced(false)
+    {
+        setOpaque(true);
+        loader.onImage = [this]() { triggerAsyncUpdate(); };
+        compressor.onCompressed = [this]() { triggerAsyncUpdate(); };
+        updatePlaylistPaths();
+        processor.apvts.state.addListener(this);
+    }
+    ~JIFViewer() override {
+        processor.apvts.state.removeListener(this);
+        exporter.cancel();
+        loader.cancel();
+        compressor.cancel();
+        scaledCache.clear();
+    }
     void freeze(const int imageIdx) {
-        stopTimer();
+        frozen = true;
         if(jif.setFrameTo(imageIdx))
             triggerRepaint();
     }
-    void unfreeze() { updateFPS(); }
+    void unfreeze() {
+        frozen = false;
+        updateFPS();
+    }
     void addListener(JIFViewerListener* c) { listeners.push_back(c); }
+    /* the viewer shrinks to a thumbnail while the controls are in front. the frames stay cached at full size then
+    and get drawn scaled down, so hovering the editor doesn't throw them away */
+    void setThumbnail(const bool isThumbnail) noexcept { thumbnail = isThumbnail; }
     void setFont(const juce::Font& f) noexcept { cFont = f; }
+    /* the viewer stays frozen while the chooser is open, whether a gif gets picked or not */
     void tryLoadWithFileChooser() {
         freeze(0);
-        juce::CriticalSection mutex;
-        juce::ScopedLock lock(mutex);
-        const auto state = processor.apvts.state;
-        const juce::String dialogBoxTitle("Load a JIF!");
-        const juce::String initDirectory = state.getProperty("directory", "");
-        bool managedToLoad = false;
-        if (initDirectory != "") {
-            juce::File directoryFile(initDirectory);
-            juce::FileChooser chooser(dialogBoxTitle, directoryFile);
-            if (chooser.browseForFileToOpen())
-                managedToLoad = tryLoad(chooser.getResult().getFullPathName());
-        }
-        else {
-            juce::FileChooser chooser(dialogBoxTitle);
-            if (chooser.browseForFileToOpen())
-                managedToLoad = tryLoad(chooser.getResult().getFullPathName());
-        }
-        if (!managedToLoad) return;
-        unfreeze();
+        const juce::File directory(processor.apvts.state.getProperty("directory", "").toString());
+        fileChooser = std::make_unique<juce::FileChooser>("Load a JIF!", directory, "*.gif");
+        const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+        fileChooser->launchAsync(flags, [this](const juce::FileChooser& chooser) {
+            const auto result = chooser.getResult();
+            if (result != juce::File())
+                tryLoad(result.getFullPathName());
+            unfreeze();
+        });
     }
+    /* starts loading the gif in the background. returns false if there is no gif at path */
     bool tryLoad(const juce::String& path) {
         if (path.endsWith(".gif")) {
             juce::File file(path);
-            juce::MemoryBlock block;
-            if (file.loadFileAsData(block)) {
-                jif.reload(block.getData(), block.getSize());
-                updateFPS();
+            if (file.existsAsFile()) {
+                scaledCache.clear();
+                compressor.cancel();
+                processor.setEmbeddedGif({});
+                loadStartMs = juce::Time::getMillisecondCounterHiRes();
+                loader.load(file);
+                jif.clear();
+                imageBytes = 0;
+                playlist.setCurrentPath(path);
                 auto& state = processor.apvts.state;
-                for (auto i = path.length() - 1; i > -1; --i)
-                    if (path[i] == '\\') {
-                        state.setProperty("directory", path.substring(0, i), nullptr);
-                        break;
-                    }
+                state.setProperty("directory", file.getParentDirectory().getFullPathName(), nullptr);
                 const auto lastProperty = state.getProperty("gif", "").toString();
-                if (path == lastProperty) {
+                loopFollowsLoad = path != lastProperty;
+                if (loopFollowsLoad)
+                    state.setProperty("gif", path, nullptr);
+                else {
                     jif.loopStart = static_cast<int>(state.getProperty("loopStart", jif.loopStart));
                     jif.loopEnd = static_cast<int>(state.getProperty("loopEnd", jif.loopEnd));
                 }
-                else {
-                    state.setProperty("gif", path, nullptr);
-                    state.setProperty("loopStart", jif.loopStart, nullptr);
-                    state.setProperty("loopEnd", jif.loopEnd, nullptr);
-                }
+                updateFPS();
                 return true;
             }
         }
         updateFPS();
         return false;
     }
-    void saveWavetable() {
-        const auto pathStr = juce::File::getSpecialLocation(
-            juce::File::SpecialLocationType::userDesktopDirectory
-        ).getFullPathName();
-        const int cyclesPerTable = 256, samplesPerCycle = 2048;
-        const int numSamples = samplesPerCycle * cyclesPerTable;
-        const int numTables = jif.numImages();
-        juce::File txtFile(pathStr + "\\FolderInfo.txt");
-        juce::FileOutputStream fileStream(txtFile);
-        fileStream.setPosition(0);
-        fileStream << "[" << juce::String(samplesPerCycle) << "]";
-        juce::AudioBuffer<float> wt;
-        juce::Image tmpImg(juce::Image::RGB, samplesPerCycle, cyclesPerTable, true);
-        const auto bounds = tmpImg.getBounds().toFloat();
-        juce::WavAudioFormat format;
-        std::unique_ptr<juce::AudioFormatWriter> writer;
-        for (auto j = 0; j < numTables; ++j) {
-            jif.setFrameTo(j);
-            juce::Graphics g{ tmpImg };
-            g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
-            jif.paint(g, bounds);
-            wt.setSize(1, numSamples, false, true, false);
-            auto samples = wt.getWritePointer(0);
-            for (auto y = 0; y < cyclesPerTable; ++y) {
-                const auto cycleIdx = y * samplesPerCycle;
-                for (auto x = 0; x < samplesPerCycle; ++x) {
-                    const auto val = tmpImg.getPixelAt(x, y).getBrightness() * 2.f - 1.f;
-                    samples[x + cycleIdx] = val;
-                }
-            }
-            const auto filePath = pathStr + "\\wt" + juce::String(j) + ".wav";
-            juce::File file(filePath);
-            writer.reset(format.createWriterFor(new juce::FileOutputStream(file),
-                44100,
-                1,
-                24,
-                {},
-                0
-            ));
-            if (writer != nullptr)
-                writer->writeFromAudioSampleBuffer(wt, 0, numSamples);
-        }
+    /* starts decoding the gif that came embedded in the session. returns false if there is none */
+    bool tryLoadEmbedded() {
+        const auto gzippedGif = processor.getEmbeddedGif();
+        if (gzippedGif.isEmpty())
+            return false;
+        scaledCache.clear();
+        compressor.cancel();
+        loadStartMs = juce::Time::getMillisecondCounterHiRes();
+        loader.load(gzippedGif);
+        jif.clear();
+        imageBytes = 0;
+        const auto& state = processor.apvts.state;
+        playlist.setCurrentPath(state.getProperty("gif", "").toString());
+        jif.loopStart = static_cast<int>(state.getProperty("loopStart", jif.loopStart));
+        jif.loopEnd = static_cast<int>(state.getProperty("loopEnd", jif.loopEnd));
+        loopFollowsLoad = false;
+        updateFPS();
+        return true;
     }
+    /* starts writing the wavetables to the desktop in the background */
+    void saveWavetable(const wt::Exporter::Options& options) {
+        const auto desktop = juce::File::getSpecialLocation(juce::File::SpecialLocationType::userDesktopDirectory);
+        const juce::File gifFile(processor.apvts.state.getProperty("gif", "").toString());
+        const auto gifName = gifFile.getFileNameWithoutExtension().isEmpty() ? juce::String("jif") : gifFile.getFileNameWithoutExtension();
+        const auto name = gifName + "_" + juce::String(options.cycleLength);
+        if (options.mode == wt::Exporter::Mode::SingleFile)
+            exporter.start(jif, desktop.getChildFile(name + ".wav"), options);
+        else if (options.mode == wt::Exporter::Mode::MipMapped)
+            exporter.start(jif, desktop.getChildFile(name + "_octaves"), options);
+        else
+            exporter.start(jif, desktop, options);
+    }
+    void cancelExport() { exporter.cancel(); }
+    /* the band-limited cycles of the last mipmapped export, to reuse them without recomputing */
+    std::shared_ptr<const wt::MipSet> getMipSet() const { return exporter.getMipSet(); }
+    bool isExporting() const { return exporter.isExporting(); }
+    float getExportProgress() const noexcept { return exporter.getProgress(); }
+    /* the decoded gif plus the display cache built from it, and the preloaded playlist entry.
+    the gif's images are only counted once they're all there, so it's cheap enough to call at every paint */
+    size_t getResidentBytes() const {
+        return imageBytes + jif.compositor.getResidentBytes() + scaledCache.getResidentBytes() + playlist.getResidentBytes();
+    }
+    /* the playlist lives in the plugin state as a "playlist" child with a "path" per "entry" child */
+    juce::StringArray getPlaylist() const { return playlist.getPaths(); }
+    int getPlaylistIndex() const { return playlist.getCurrentIndex(); }
+    void setPlaylist(const juce::StringArray& paths) {
+        auto state = processor.apvts.state;
+        state.removeChild(state.getChildWithName("playlist"), nullptr);
+        juce::ValueTree list("playlist");
+        for (const auto& path : paths)
+            list.appendChild(juce::ValueTree("entry", { { "path", path } }), nullptr);
+        state.appendChild(list, nullptr);
+        updatePlaylistPaths();
+    }
+    /* switches as soon as the entry is decoded, the current gif keeps playing until then */
+    void selectPlaylistEntry(const int idx) { playlistTarget = idx; }
+    /* switches to the next entry every numBars bars while the host plays, 0 turns it off */
+    void setPlaylistBars(const int numBars) { processor.apvts.state.setProperty("playlistBars", numBars, nullptr); }
+    int getPlaylistBars() const { return static_cast<int>(processor.apvts.state.getProperty("playlistBars", 0)); }
     jif::JIF jif;
 protected:
     JIFAudioProcessor& processor;
+    jif::AsyncLoader loader;
+    jif::Compressor compressor;
+    jif::ScaledCache scaledCache;
+    jif::Playlist playlist;
+    wt::Exporter exporter;
     std::vector<JIFViewerListener*> listeners;
+    std::vector<midi::Event> pendingMidi;
+    std::unique_ptr<juce::FileChooser> fileChooser;
     juce::Font cFont;
     juce::Rectangle<float> bounds;
-    float fps, speedValue;
+    /* the size the scaled cache gets built at, the viewer's full size */
+    juce::Rectangle<int> cacheBounds;
+    juce::VBlankAttachment vBlank;
+    perf::Stats& perf;
+    float fps, speedValue, audioEnvelope;
+    double lastVBlankMs, vBlankIntervalMs, freeRunSteps, loadStartMs;
+    /* how many vblanks the frame on screen has been there for */
+    int vBlanksShown;
+    /* what the images of the gif that is playing take, counted when it's done loading */
+    size_t imageBytes;
+    int repaintedIdx, repaintedBlendIdx, repaintedAlpha;
+    /* where the crossfade gets blended into, reused as long as the size stays the same */
+    juce::Image blended;
+    int playlistTarget, lastEntryParam, lastBarIdx;
+    bool statsShown, thumbnail, embedding, frozen, loopFollowsLoad;
+    /* set when the host replaced the plugin state, on whatever thread it did that */
+    std::atomic<bool> stateReplaced;
+
+    /* replaceState assigns a new tree to apvts.state, which redirects its listeners */
+    void valueTreeRedirected(juce::ValueTree&) override { stateReplaced = true; }
+    /* a preset or session the host loaded while the editor is open. its playlist and gif get loaded like when the editor opens */
+    void updateState() {
+        if (!stateReplaced.exchange(false)) return;
+        updatePlaylistPaths();
+        playlistTarget = lastBarIdx = -1;
+        lastEntryParam = static_cast<int>(processor.entry->load());
+        if (!tryLoadEmbedded())
+            tryLoad(processor.apvts.state.getProperty("gif", "").toString());
+    }
 
-    void timerCallback() override {
+    /* renders in sync with the display. the frame is picked from the tempo phase at each vblank,
+    or advanced by the input in the audio-reactive sync modes */
+    void onVBlank() {
+        const auto now = juce::Time::getMillisecondCounterHiRes();
+        const auto elapsedMs = lastVBlankMs > 0. ? now - lastVBlankMs : 0.;
+        lastVBlankMs = now;
+        updateVBlankStats(elapsedMs);
+        updateState();
+        updateEmbedding();
+        /* the queues get emptied while frozen as well, so they don't fill up with stale events */
+        const auto syncMode = static_cast<int>(processor.sync->load());
+        const auto onset = readAudioEvents();
+        readMidiEvents(syncMode == 3 && !frozen);
+        if (frozen) return;
+        const auto direction = static_cast<jif::Direction>(static_cast<int>(processor.direction->load()));
+        if (jif.direction != direction) {
+            jif.direction = direction;
+            updateFPS();
+        }
         const auto newSpeedValue = processor.speed->load();
         if (speedValue != newSpeedValue) {
                 speedValue = newSpeedValue;
                 const auto speed = convertSpeed(speedValue);
-                const auto range = static_cast<float>(jif.loopEnd - jif.loopStart);
+                const auto range = static_cast<float>(jif.getNumSteps());
                 updateFPS(speed, range);
             }
-        if (!processor.hasPlayhead.load()) {
-            ++jif;
-            return triggerRepaint();
+        const auto snapshot = processor.playhead.read();
+        updatePlaylist(snapshot);
+        switch (syncMode) {
+        case 1: return freeRun(elapsedMs * .001 * fps * getLevelRate());
+        case 2:
+            if (onset) {
+                freeRunSteps = 0.;
+                if (jif.restart()) {
+                    countFrame(1);
+                    return triggerRepaint();
+                }
+                return;
+            }
+            return freeRun(elapsedMs * .001 * fps);
+        case 3: return followMidi(elapsedMs, now);
+        default: break;
+        }
+        if (!snapshot.hasPlayhead)
+            return freeRun(elapsedMs * .001 * fps);
+        if (!snapshot.isPlaying) {
+            vBlanksShown = 0;
+            return updateListeners();
         }
-        if (!processor.isPlaying.load()) return updateListeners();
-        const auto ppq = processor.ppq.load();
+        perf.renderLatency.add(now - snapshot.timeMs);
+        const auto ppq = getTempoPhase(snapshot, now);
         const auto phase = processor.phase->load();
-        if (jif.setFrameTo(ppq, phase))
+        const auto lastIdx = jif.readIdx;
+        if (jif.setFrameTo(ppq, phase)) {
+            countFrame(jif.getStepsBetween(lastIdx, jif.readIdx));
+            return triggerRepaint();
+        }
+        if (++vBlanksShown > getExpectedVBlanks(snapshot))
+            ++perf.framesRepeated;
+        if (blendChanged())
             triggerRepaint();
     }
+    /* the most vblanks the frame on screen can fall on while its delay lasts at the tempo */
+    int getExpectedVBlanks(const PlayheadSnapshot& snapshot) {
+        if (vBlankIntervalMs <= 0. || snapshot.bpm <= 0.)
+            return std::numeric_limits<int>::max();
+        const auto loopMs = 60000. / (snapshot.bpm * getLoopsPerBeat());
+        const auto frameMs = loopMs * static_cast<double>(jif.getShareOfLoop(jif.readIdx));
+        return static_cast<int>(frameMs / vBlankIntervalMs) + 1;
+    }
+    /* plays numFrames further, keeping the fractional part for the next vblank.
+    whole loops are skipped, so a long stall still lands where playback would be */
+    void freeRun(const double numFrames) {
+        freeRunSteps += numFrames;
+        const auto numSteps = static_cast<int>(freeRunSteps);
+        freeRunSteps -= numSteps;
+        const auto loopLength = jif.getNumSteps();
+        for (auto i = 0; i < (loopLength > 0 ? numSteps % loopLength : 0); ++i)
+            ++jif;
+        if (isCrossfading())
+            jif.setBlend(static_cast<float>(freeRunSteps));
+        if (numSteps != 0)
+            countFrame(numSteps);
+        else if (!blendChanged())
+            return;
+        triggerRepaint();
+    }
+    bool isCrossfading() const { return static_cast<bool>(processor.apvts.state.getProperty("crossfade", false)); }
+    /* how much of the next image is blended in, from 0 to kernel::maxAlpha. it stays 0 unless both images are in the scaled cache,
+    so nothing gets repainted for a crossfade that can't be drawn */
+    int getBlendAlpha() const {
+        if (!isCrossfading() || jif.empty() || !scaledCache.get(jif.readIdx).isValid() || !scaledCache.get(jif.blendIdx).isValid())
+            return 0;
+        return juce::jlimit(0, jif::kernel::maxAlpha, juce::roundToInt(jif.blend * static_cast<float>(jif::kernel::maxAlpha)));
+    }
+    bool blendChanged() const {
+        const auto alpha = getBlendAlpha();
+        return alpha != repaintedAlpha || (alpha != 0 && jif.blendIdx != repaintedBlendIdx);
+    }
+    /* takes everything the audio thread sent since the last vblank, so the queue never fills up.
+    returns true if there was an onset among it */
+    bool readAudioEvents() noexcept {
+        auto onset = false;
+        audio::Event event;
+        while (processor.audioEvents.pop(event)) {
+            onset = onset || event.onset;
+            audioEnvelope = event.envelope;
+        }
+        return onset;
+    }
+    /* moves the midi events over to pendingMidi, where they wait until it's their time. they're only kept in midi mode */
+    void readMidiEvents(const bool keep) {
+        midi::Event event;
+        while (processor.midiEvents.pop(event))
+            if (event.type == midi::Event::Type::Select)
+                playlistTarget = event.value;
+            else if (keep)
+                pendingMidi.push_back(event);
+        if (!keep)
+            pendingMidi.clear();
+    }
+    /* shows the last midi event whose time has come, then plays on from there until the next one */
+    void followMidi(const double elapsedMs, const double now) {
+        const auto numDue = static_cast<int>(std::find_if(pendingMidi.begin(), pendingMidi.end(),
+            [now](const midi::Event& e) { return e.timeMs > now; }) - pendingMidi.begin());
+        if (numDue == 0)
+            return freeRun(elapsedMs * .001 * fps);
+        const auto& event = pendingMidi[static_cast<size_t>(numDue - 1)];
+        perf.renderLatency.add(now - event.timeMs);
+        freeRunSteps = 0.;
+        const auto changed = jif.restart(midi::getStep(event, jif.getNumSteps()));
+        pendingMidi.erase(pendingMidi.begin(), pendingMidi.begin() + numDue);
+        if (!changed) return;
+        countFrame(1);
+        triggerRepaint();
+    }
+    void updatePlaylistPaths() {
+        juce::StringArray paths;
+        for (const auto& entry : processor.apvts.state.getChildWithName("playlist"))
+            paths.add(entry.getProperty("path").toString());
+        playlist.setPaths(paths);
+    }
+    /* the entry that should play is the last one the entry parameter, a program change or the bar count asked for.
+    the gif that comes next is always being preloaded, so switching to it is a swap at the vblank it's due */
+    void updatePlaylist(const PlayheadSnapshot& snapshot) {
+        const auto numEntries = playlist.size();
+        if (numEntries == 0) return;
+        const auto entryParam = static_cast<int>(processor.entry->load());
+        if (entryParam != lastEntryParam) {
+            lastEntryParam = entryParam;
+            playlistTarget = entryParam;
+        }
+        const auto numBars = getPlaylistBars();
+        if (numBars > 0 && snapshot.hasPlayhead && snapshot.isPlaying) {
+            const auto barIdx = static_cast<int>(std::floor(static_cast<double>(snapshot.bar) / numBars));
+            if (barIdx != lastBarIdx) {
+                lastBarIdx = barIdx;
+                playlistTarget = barIdx;
+            }
+        }
+        const auto currentIdx = playlist.getCurrentIndex();
+        if (playlistTarget < 0)
+            return playlist.preload((currentIdx + 1) % numEntries);
+        const auto targetIdx = playlistTarget % numEntries;
+        if (targetIdx == currentIdx) {
+            playlistTarget = -1;
+            return;
+        }
+        if (!playlist.isReady(targetIdx))
+            return playlist.preload(targetIdx);
+        swapPlaylistEntry();
+        playlistTarget = -1;
+        playlist.preload((targetIdx + 1) % numEntries);
+    }
+    void swapPlaylistEntry() {
+        loader.cancel();
+        compressor.cancel();
+        processor.setEmbeddedGif({});
+        playlist.swapInto(jif);
+        imageBytes = jif.getImageBytes();
+        auto& state = processor.apvts.state;
+        state.setProperty("gif", playlist.getPaths()[playlist.getCurrentIndex()], nullptr);
+        state.setProperty("loopStart", jif.loopStart, nullptr);
+        state.setProperty("loopEnd", jif.loopEnd, nullptr);
+        loopFollowsLoad = false;
+        compressIfEmbedding();
+        scaledCache.rebuild(jif, cacheBounds);
+        perf.residentBytes = static_cast<juce::int64>(getResidentBytes());
+        updateFPS();
+        repaintAll();
+        updateListeners();
+    }
+    /* how fast the level mode plays: stands still at -48 dB, normal speed at -24 dB and twice as fast at 0 dB */
+    float getLevelRate() const noexcept {
+        const auto db = juce::Decibels::gainToDecibels(audioEnvelope, -60.f);
+        return juce::jlimit(0.f, 2.f, (db + 48.f) / 24.f);
+    }
+    /* the loop phase at render time. the block's ppq gets moved on by the time that passed since the block,
+    so the sync doesn't depend on the host's buffer size */
+    float getTempoPhase(const PlayheadSnapshot& snapshot, const double nowMs) const noexcept {
+        static constexpr double maxExtrapolationMs = 250.;
+        const auto elapsedMs = juce::jlimit(0., maxExtrapolationMs, nowMs - snapshot.timeMs);
+        const auto ppq = snapshot.ppq + elapsedMs * .001 * snapshot.bpm / 60.;
+        const auto curPPQ = ppq * getLoopsPerBeat();
+        return static_cast<float>(curPPQ - std::floor(curPPQ));
+    }
+    double getLoopsPerBeat() const noexcept { return std::pow(2., static_cast<double>(speedValue)) * .25; }
+    void countFrame(const int numSteps) noexcept {
+        vBlanksShown = 1;
+        ++perf.framesShown;
+        perf.framesSkipped += juce::jmax(0, numSteps - 1);
+    }
+    /* a vblank that took way longer than usual means a refresh without a new frame.
+    jitter is measured against the usual interval */
+    void updateVBlankStats(const double elapsedMs) noexcept {
+        if (elapsedMs <= 0.) return;
+        ++perf.vBlanks;
+        perf.vBlankInterval.add(elapsedMs);
+        if (vBlankIntervalMs > 0.)
+            perf.vBlankJitter.add(std::abs(elapsedMs - vBlankIntervalMs));
+        if (vBlankIntervalMs > 0. && elapsedMs > vBlankIntervalMs * 1.5)
+            ++perf.vBlanksLate;
+        else
+            vBlankIntervalMs = vBlankIntervalMs > 0. ? vBlankIntervalMs * .95 + elapsedMs * .05 : elapsedMs;
+    }
     void triggerRepaint() {
-        handleAsyncUpdate();
+        collectImages();
+        repaintChangedArea();
         updateListeners();
     }
+    /* only repaints where the new image can differ from the last one that got repainted */
+    void repaintChangedArea() {
+        if (jif.empty())
+            return repaintAll();
+        /* with a crossfade it's wherever the images on either side of the old or the new blend differ */
+        const auto alpha = getBlendAlpha();
+        auto area = jif.getChangedArea(repaintedIdx, jif.readIdx);
+        if (repaintedAlpha != 0)
+            area = area.getUnion(jif.getChangedArea(repaintedIdx, repaintedBlendIdx));
+        if (alpha != 0)
+            area = area.getUnion(jif.getChangedArea(jif.readIdx, jif.blendIdx));
+        repaintedIdx = jif.readIdx;
+        repaintedBlendIdx = jif.blendIdx;
+        repaintedAlpha = alpha;
+        /* once more after the overlay was switched off, to clear it */
+        const auto showStats = isShowingStats();
+        if (showStats || statsShown)
+            repaint(getStatsArea());
+        statsShown = showStats;
+        if (area.isEmpty()) return;
+        repaint(toPixels(area));
+    }
+    /* a normalized area of the gif on screen, with a margin for the resampling */
+    juce::Rectangle<int> toPixels(const juce::Rectangle<float>& area) const { return toPixels(area, bounds); }
+    static juce::Rectangle<int> toPixels(const juce::Rectangle<float>& area, const juce::Rectangle<float>& size) {
+        const auto w = size.getWidth();
+        const auto h = size.getHeight();
+        const juce::Rectangle<float> scaledArea(area.getX() * w, area.getY() * h, area.getWidth() * w, area.getHeight() * h);
+        return scaledArea.expanded(2.f).getSmallestIntegerContainer();
+    }
+    void repaintAll() {
+        repaintedIdx = jif.readIdx;
+        repaint();
+    }
     void updateListeners() {
         for (auto comp : listeners)
             comp->viewerUpdated();
     }
-    void handleAsyncUpdate() override { repaint(); }
+    void handleAsyncUpdate() override {
+        auto gzippedGif = compressor.take();
+        if (!gzippedGif.isEmpty())
+            processor.setEmbeddedGif(std::move(gzippedGif));
+        collectImages();
+        repaintAll();
+    }
+    bool isEmbedding() const { return static_cast<bool>(processor.apvts.state.getProperty("embedGif", false)); }
+    /* a gif only gets gzipped for the plugin state once embedding is on */
+    void updateEmbedding() {
+        const auto embed = isEmbedding();
+        if (embedding == embed) return;
+        embedding = embed;
+        if (embedding)
+            compressIfEmbedding();
+        else
+            compressor.cancel();
+    }
+    /* starts gzipping the gif file in the background, unless the state holds it already.
+    it waits for the gif to be decoded, so it never holds up loading */
+    void compressIfEmbedding() {
+        if (!embedding || loader.isLoading() || compressor.isThreadRunning() || processor.hasEmbeddedGif())
+            return;
+        const juce::File file(processor.apvts.state.getProperty("gif", "").toString());
+        if (file.existsAsFile())
+            compressor.compress(file);
+    }
+    /* takes over what the loader decoded so far. a new gif's loop end sticks to its last image while loading */
+    void collectImages() {
+        const auto numImagesBefore = static_cast<int>(jif.numImages());
+        const auto loopEndBefore = jif.loopEnd;
+        const auto status = loader.collect(jif);
+        if (status == jif::AsyncLoader::Status::Idle) return;
+        if (loopFollowsLoad) {
+            if (jif.loopEnd == numImagesBefore)
+                jif.loopEnd = static_cast<int>(jif.numImages());
+            if (status == jif::AsyncLoader::Status::Finished) {
+                auto& state = processor.apvts.state;
+                state.setProperty("loopStart", jif.loopStart, nullptr);
+                state.setProperty("loopEnd", jif.loopEnd, nullptr);
+                loopFollowsLoad = false;
+            }
+        }
+        if (status == jif::AsyncLoader::Status::Finished) {
+            if (!jif.empty())
+                compressIfEmbedding();
+            scaledCache.rebuild(jif, cacheBounds);
+            imageBytes = jif.getImageBytes();
+            perf.decodeTime.add(juce::Time::getMillisecondCounterHiRes() - loadStartMs);
+            perf.residentBytes = static_cast<juce::int64>(getResidentBytes());
+        }
+        if (loopEndBefore != jif.loopEnd)
+            updateFPS();
+        updateListeners();
+    }
     void paint(juce::Graphics& g) override {
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
         g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
         g.setFont(cFont);
-        jif.paint(g, bounds);
+        const auto scaled = scaledCache.get(jif.readIdx);
+        if (scaled.isValid()) {
+            if (scaled.getBounds() == getLocalBounds())
+                g.drawImageAt(scaled, 0, 0);
+            else
+                g.drawImage(scaled, bounds);
+            paintCrossfade(g, scaled);
+        }
+        else
+            jif.paint(g, bounds);
+        if (isShowingStats())
+            paintStats(g);
+        perf.paintDuration.add(juce::Time::getMillisecondCounterHiRes() - startMs);
+    }
+    /* blends the next image in where it differs from the current one. it needs both of them in the scaled cache,
+    the canvas of the compositor can't hold 2 frames at once. the blend happens at the cache's size,
+    which is bigger than the viewer while it's a thumbnail. rows that are the same in both are left as painted */
+    void paintCrossfade(juce::Graphics& g, const juce::Image& scaled) {
+        if (getBlendAlpha() == 0) return;
+        const auto next = scaledCache.get(jif.blendIdx);
+        if (!next.isValid() || next.getBounds() != scaled.getBounds() || next.getFormat() != scaled.getFormat())
+            return;
+        const auto toViewer = juce::AffineTransform::scale(bounds.getWidth() / static_cast<float>(scaled.getWidth()),
+            bounds.getHeight() / static_cast<float>(scaled.getHeight()));
+        const auto clip = g.getClipBounds().toFloat().transformedBy(toViewer.inverted()).getSmallestIntegerContainer();
+        const auto area = toPixels(jif.getChangedArea(jif.readIdx, jif.blendIdx), scaled.getBounds().toFloat())
+            .getIntersection(clip).getIntersection(scaled.getBounds());
+        if (area.isEmpty()) return;
+        for (const auto& rows : jif::crossfade(scaled, next, blended, area, jif.blend))
+            g.drawImageTransformed(blended.getClippedImage(rows),
+                juce::AffineTransform::translation(static_cast<float>(rows.getX()), static_cast<float>(rows.getY())).followedBy(toViewer));
+    }
+    bool isShowingStats() const { return static_cast<bool>(processor.apvts.state.getProperty("showStats", false)); }
+    juce::Rectangle<int> getStatsArea() const { return { 0, 0, juce::jmin(getWidth(), 240), juce::jmin(getHeight(), 160) }; }
+    void paintStats(juce::Graphics& g) {
+        const auto area = getStatsArea();
+        g.setColour(juce::Colour(0xbb000000));
+        g.fillRect(area);
+        g.setColour(juce::Colours::white);
+        g.setFont(12);
+        const auto lines = perf.toLines();
+        const auto lineHeight = static_cast<float>(area.getHeight()) / static_cast<float>(lines.size());
+        for (auto i = 0; i < lines.size(); ++i)
+            g.drawFittedText(lines[i], juce::Rectangle<float>(4.f, lineHeight * i, static_cast<float>(area.getWidth()) - 8.f, lineHeight).toNearestInt(),
+                juce::Justification::centredLeft, 1, 0);
+    }
+    void resized() override {
+        bounds = getLocalBounds().toFloat();
+        if (thumbnail) return;
+        cacheBounds = getLocalBounds();
+        if (!loader.isLoading() && scaledCache.getSize() != cacheBounds)
+            scaledCache.rebuild(jif, cacheBounds);
     }
-    void resized() override { bounds = getLocalBounds().toFloat(); }
 
     inline float convertSpeed(const float s) const noexcept { return std::pow(2.f, s); }
     void updateFPS(const float speed, const float range) noexcept {
-        fps = juce::jlimit(1.f, 50.f, speed * range);
-        startTimer(static_cast<int>(1000.f / fps));
+        fps = speed * range;
     }
     void updateFPS() noexcept {
         const auto speed = convertSpeed(speedValue);
-        const auto range = static_cast<float>(jif.loopEnd - jif.loopStart);
+        const auto range = static_cast<float>(jif.getNumSteps());
         updateFPS(speed, range);
     }
 
@@ -185,9 +618,4 @@ protected:
 *
 * if(!isPlaying) still be able to open controls editor
 * 
-* frame drop less
-*   alternate thread?
-*
-* reverse button?
-*   erfordert loopup table jif
 */
\ No newline at end of file
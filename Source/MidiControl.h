@@ -0,0 +1,54 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioAnalysis.h"
+
+namespace midi {
+    /* a note-on restarts the loop at the slice its note selects, the mod wheel scrubs through the loop
+    and a program change selects a playlist entry. timeMs is when the event's sample plays, counted from the start of its block */
+    struct Event {
+        enum class Type { Retrigger, Scrub, Select };
+
+        double timeMs;
+        int sampleOffset;
+        Type type;
+        int value; // note number for Retrigger, 0 - 127 for Scrub, program number for Select
+    };
+
+    using Queue = audio::Fifo<Event, 512>;
+
+    /* C restarts the loop at loop start, every semitone above starts a twelfth of the loop later */
+    inline int getStep(const Event& event, const int numSteps) noexcept {
+        if (numSteps <= 0) return 0;
+        if (event.type == Event::Type::Retrigger)
+            return (event.value % 12) * numSteps / 12;
+        return juce::jmin(numSteps - 1, event.value * numSteps / 128);
+    }
+
+    /* passes the block's program changes on to the viewer, and its note-ons and mod wheel moves if withPlayback.
+    only meant for blocks that have midi in them. returns how many events didn't fit into queue */
+    inline int process(const juce::MidiBuffer& buffer, const double blockStartMs, const double sampleRate, Queue& queue, const bool withPlayback) noexcept {
+        const auto msPerSample = 1000. / (sampleRate > 0. ? sampleRate : 44100.);
+        auto numDropped = 0;
+        for (const auto metadata : buffer) {
+            const auto msg = metadata.getMessage();
+            Event event{ blockStartMs + metadata.samplePosition * msPerSample, metadata.samplePosition, Event::Type::Retrigger, 0 };
+            if (msg.isProgramChange()) {
+                event.type = Event::Type::Select;
+                event.value = msg.getProgramChangeNumber();
+            }
+            else if (!withPlayback)
+                continue;
+            else if (msg.isNoteOn())
+                event.value = msg.getNoteNumber();
+            else if (msg.isControllerOfType(1)) {
+                event.type = Event::Type::Scrub;
+                event.value = msg.getControllerValue();
+            }
+            else
+                continue;
+            if (!queue.push(event))
+                ++numDropped;
+        }
+        return numDropped;
+    }
+}
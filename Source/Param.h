@@ -2,12 +2,15 @@
 #include <JuceHeader.h>
 
 namespace param {
-	enum class ID { Speed, Phase };
+	enum class ID { Speed, Phase, Direction, Sync, Entry };
 
 	static juce::String getName(ID i) {
 		switch (i) {
 		case ID::Speed: return "Speed";
 		case ID::Phase: return "Phase";
+		case ID::Direction: return "Direction";
+		case ID::Sync: return "Sync";
+		case ID::Entry: return "Entry";
 		default: return "";
 		}
 	}
@@ -51,6 +54,13 @@ namespace param {
 
 		parameters.push_back(createParameter(ID::Speed, juce::NormalisableRange<float>(-2, 2, 1), 0, speedStr));
 		parameters.push_back(createParameter(ID::Phase, juce::NormalisableRange<float>(0, 1, 1.f / 360.f), 0, phaseStr));
+		parameters.push_back(createPChoice(ID::Direction, { "Forward", "Reverse", "Ping Pong" }, 0));
+		/* tempo follows the host. level plays faster the louder the input is, onsets restart the loop on every hit,
+		midi restarts it on note-ons and scrubs it with the mod wheel */
+		parameters.push_back(createPChoice(ID::Sync, { "Tempo", "Level", "Onsets", "MIDI" }, 0));
+		/* the playlist entry to show. changing it switches, entries past the end wrap around */
+		parameters.push_back(createParameter(ID::Entry, juce::NormalisableRange<float>(0, 31, 1), 0,
+			[](float value, int) { return juce::String(static_cast<int>(value) + 1); }));
 		
 		return { parameters.begin(), parameters.end() };
 	}
@@ -0,0 +1,89 @@
+#pragma once
+#include "JIF.h"
+
+namespace jif {
+    /* a list of gif files to switch between on cue. the entry that comes next gets decoded in the background
+    while the current one plays, so switching to it is only a swap. besides the gif that is playing,
+    at most the one that comes next is resident */
+    class Playlist {
+    public:
+        Playlist() :
+            paths(),
+            currentPath(),
+            next(),
+            nextIdx(-1),
+            nextReady(false),
+            nextBytes(0),
+            preloader()
+        {}
+        ~Playlist() { preloader.cancel(); }
+        /* keeps the preloaded entry if it's still in the list */
+        void setPaths(const juce::StringArray& newPaths) {
+            const auto nextPath = paths[nextIdx];
+            paths = newPaths;
+            nextIdx = paths.indexOf(nextPath);
+            if (nextIdx == -1)
+                discardNext();
+        }
+        const juce::StringArray& getPaths() const noexcept { return paths; }
+        int size() const noexcept { return paths.size(); }
+        /* -1 if the gif that is playing isn't from the playlist */
+        int getCurrentIndex() const { return currentPath.isEmpty() ? -1 : paths.indexOf(currentPath); }
+        void setCurrentPath(const juce::String& path) { currentPath = path; }
+        /* starts decoding entry idx, unless it's already there or on its way. whatever was preloaded before gets released.
+        an entry whose file is gone is remembered as well, so it doesn't get looked for again at every call */
+        void preload(const int idx) {
+            if (idx < 0 || idx >= paths.size() || idx == nextIdx)
+                return;
+            discardNext();
+            nextIdx = idx;
+            const juce::File file(paths[idx]);
+            if (file.existsAsFile())
+                preloader.load(file);
+        }
+        /* true once entry idx is decoded completely */
+        bool isReady(const int idx) {
+            if (idx != nextIdx)
+                return false;
+            if (!nextReady && preloader.collect(next) == AsyncLoader::Status::Finished) {
+                next.loopStart = 0;
+                next.loopEnd = static_cast<int>(next.numImages());
+                nextReady = !next.empty();
+                nextBytes = next.getResidentBytes();
+            }
+            return nextReady;
+        }
+        /* swaps the preloaded entry into jif and releases the gif that was playing before.
+        returns false if there was nothing to swap in */
+        bool swapInto(JIF& jif) {
+            if (!nextReady)
+                return false;
+            next.direction = jif.direction;
+            std::swap(jif, next);
+            jif.restart();
+            currentPath = paths[nextIdx];
+            discardNext();
+            return true;
+        }
+        /* counted once the entry is preloaded */
+        size_t getResidentBytes() const noexcept { return nextBytes; }
+    private:
+        juce::StringArray paths;
+        juce::String currentPath;
+        JIF next;
+        int nextIdx;
+        bool nextReady;
+        size_t nextBytes;
+        AsyncLoader preloader;
+
+        void discardNext() {
+            preloader.cancel();
+            next.clear();
+            nextIdx = -1;
+            nextReady = false;
+            nextBytes = 0;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Playlist)
+    };
+}
@@ -21,7 +21,8 @@ JIFAudioProcessorEditor::JIFAudioProcessorEditor (JIFAudioProcessor& p)
 
     auto& state = p.apvts.state;
     auto path = state.getProperty("gif", "").toString();
-    viewer.tryLoad(path);
+    if (!viewer.tryLoadEmbedded())
+        viewer.tryLoad(path);
     viewer.addListener(this);
 
     setOpaque(true);
@@ -53,6 +54,7 @@ void JIFAudioProcessorEditor::viewerUpdated() {
     const auto viewerInFG = !isMouseOverOrDragging(true);
     if (viewerInForeground != viewerInFG) {
         viewerInForeground = viewerInFG;
+        viewer.setThumbnail(!viewerInForeground);
         if (viewerInForeground)
             viewer.setBounds(getLocalBounds());
         else {
@@ -1,5 +1,6 @@
 #pragma once
 #include <JuceHeader.h>
+#include "BinaryData.h"
 #include "PluginProcessor.h"
 
 static juce::Font getCustomFont() noexcept {
@@ -11,13 +11,20 @@ JIFAudioProcessor::JIFAudioProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        ),
-    ppq(0),
-    isPlaying(false),
-    hasPlayhead(false),
-    posInfo(),
+    playhead(),
+    perf(),
+    lastBlockMs(0.),
+    analyzer(),
+    audioEvents(),
+    midiEvents(),
+    embeddedGifMutex(),
+    embeddedGif(),
     apvts(*this, nullptr, "params", param::createParameters()),
     speed(apvts.getRawParameterValue(param::getID(param::ID::Speed))),
-    phase(apvts.getRawParameterValue(param::getID(param::ID::Phase)))
+    phase(apvts.getRawParameterValue(param::getID(param::ID::Phase))),
+    direction(apvts.getRawParameterValue(param::getID(param::ID::Direction))),
+    sync(apvts.getRawParameterValue(param::getID(param::ID::Sync))),
+    entry(apvts.getRawParameterValue(param::getID(param::ID::Entry)))
 #endif
 {
 
@@ -90,10 +97,9 @@ void JIFAudioProcessor::changeProgramName (int, const juce::String&)
 }
 
 //==============================================================================
-void JIFAudioProcessor::prepareToPlay (double, int)
+void JIFAudioProcessor::prepareToPlay (double sampleRate, int)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    analyzer.prepare(sampleRate);
 }
 
 void JIFAudioProcessor::releaseResources()
@@ -128,21 +134,52 @@ bool JIFAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) cons
 }
 #endif
 
-void JIFAudioProcessor::processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) {
-    auto playHead = getPlayHead();
-    if (playHead) {
-        hasPlayhead.store(true);
-        playHead->getCurrentPosition(posInfo);
-        isPlaying.store(posInfo.isPlaying);
-
-        const auto speedValue = speed->load();
-        const auto speedConv = std::pow(2.f, speedValue) * .25f;
-        const auto curPPQ = static_cast<float>(posInfo.ppqPosition) * speedConv;
-        const auto ppqFrac = curPPQ - std::floor(curPPQ);
-        ppq.store(ppqFrac);
+void JIFAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
+    /* a host time that far off the local clock can't be on the same clock */
+    static constexpr double maxHostTimeOffsetMs = 1000.;
+    PlayheadSnapshot snapshot{};
+    const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+    snapshot.timeMs = nowMs;
+    perf.blockSize.add(static_cast<double>(buffer.getNumSamples()));
+    if (lastBlockMs > 0.)
+        perf.blockInterval.add(nowMs - lastBlockMs);
+    lastBlockMs = nowMs;
+    snapshot.sampleRate = getSampleRate();
+    if (auto playHead = getPlayHead())
+        if (const auto position = playHead->getPosition()) {
+            snapshot.hasPlayhead = true;
+            snapshot.isPlaying = position->getIsPlaying();
+            snapshot.ppq = position->getPpqPosition().orFallback(0.);
+            snapshot.bpm = position->getBpm().orFallback(120.);
+            snapshot.timeInSamples = position->getTimeInSamples().orFallback(0);
+            /* hosts that don't count bars at least tell where the last one started, which only needs the time signature */
+            const auto timeSignature = position->getTimeSignature().orFallback(juce::AudioPlayHead::TimeSignature{});
+            const auto barLength = 4. * juce::jmax(1, timeSignature.numerator) / juce::jmax(1, timeSignature.denominator);
+            if (const auto barCount = position->getBarCount())
+                snapshot.bar = *barCount;
+            else if (const auto lastBarStart = position->getPpqPositionOfLastBarStart())
+                snapshot.bar = static_cast<juce::int64>(std::llround(*lastBarStart / barLength));
+            else
+                snapshot.bar = static_cast<juce::int64>(std::floor(snapshot.ppq / barLength));
+            if (const auto hostTimeNs = position->getHostTimeNs()) {
+                snapshot.hostTimeNs = *hostTimeNs;
+                snapshot.hasHostTime = true;
+                const auto hostTimeMs = static_cast<double>(*hostTimeNs) * 1e-6;
+                if (std::abs(hostTimeMs - nowMs) < maxHostTimeOffsetMs)
+                    snapshot.timeMs = hostTimeMs;
+            }
+        }
+    const auto syncMode = static_cast<int>(sync->load());
+    if (syncMode == 1 || syncMode == 2) {
+        const auto analysisStartMs = juce::Time::getMillisecondCounterHiRes();
+        audio::Event event;
+        if (analyzer.process(buffer, snapshot.timeMs, event) && !audioEvents.push(event))
+            ++perf.eventsDropped;
+        perf.analysisTime.add((juce::Time::getMillisecondCounterHiRes() - analysisStartMs) * 1000.);
     }
-    else
-        hasPlayhead.store(false);
+    if (!midiMessages.isEmpty())
+        perf.eventsDropped += midi::process(midiMessages, snapshot.timeMs, snapshot.sampleRate, midiEvents, syncMode == 3);
+    playhead.write(snapshot);
 }
 
 //==============================================================================
@@ -157,13 +194,24 @@ juce::AudioProcessorEditor* JIFAudioProcessor::createEditor()
 }
 
 //==============================================================================
+// the embedded gif sits behind the xml: [xml][gzipped gif][int64 size][int32 magic]
+static constexpr int embeddedGifMagic = 0x4a494667; // "JIFg"
+
 void JIFAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // SAFE GIF
-
     auto state = apvts.copyState();
     std::unique_ptr<juce::XmlElement> xml(state.createXml());
     copyXmlToBinary(*xml, destData);
+
+    if (!static_cast<bool>(state.getProperty("embedGif", false)))
+        return;
+    const juce::ScopedLock lock(embeddedGifMutex);
+    if (embeddedGif.isEmpty())
+        return;
+    juce::MemoryOutputStream out(destData, true);
+    out.write(embeddedGif.getData(), embeddedGif.getSize());
+    out.writeInt64(static_cast<juce::int64>(embeddedGif.getSize()));
+    out.writeInt(embeddedGifMagic);
 }
 
 void JIFAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -173,7 +221,35 @@ void JIFAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
         if (xmlState->hasTagName(apvts.state.getType()))
             apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
 
-    // LOAD GIF
+    // only stash the bytes here, the viewer decodes them on its loader thread
+    juce::MemoryBlock gif;
+    const auto footerSize = static_cast<int>(sizeof(juce::int64) + sizeof(juce::int32));
+    if (sizeInBytes > footerSize) {
+        const auto bytes = static_cast<const char*>(data);
+        juce::MemoryInputStream footer(bytes + sizeInBytes - footerSize, static_cast<size_t>(footerSize), false);
+        const auto gifSize = footer.readInt64();
+        if (footer.readInt() == embeddedGifMagic && gifSize > 0 && gifSize <= sizeInBytes - footerSize)
+            gif.append(bytes + sizeInBytes - footerSize - static_cast<int>(gifSize), static_cast<size_t>(gifSize));
+    }
+    setEmbeddedGif(std::move(gif));
+}
+
+void JIFAudioProcessor::setEmbeddedGif(juce::MemoryBlock&& gzippedGif)
+{
+    const juce::ScopedLock lock(embeddedGifMutex);
+    embeddedGif.swapWith(gzippedGif);
+}
+
+juce::MemoryBlock JIFAudioProcessor::getEmbeddedGif() const
+{
+    const juce::ScopedLock lock(embeddedGifMutex);
+    return embeddedGif;
+}
+
+bool JIFAudioProcessor::hasEmbeddedGif() const
+{
+    const juce::ScopedLock lock(embeddedGifMutex);
+    return !embeddedGif.isEmpty();
 }
 
 //==============================================================================
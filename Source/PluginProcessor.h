@@ -1,7 +1,56 @@
 #pragma once
 #include "Param.h"
+#include "Instrumentation.h"
+#include "AudioAnalysis.h"
+#include "MidiControl.h"
 #include <JuceHeader.h>
 
+/* one consistent view of the host's playhead, taken at the start of a block */
+struct PlayheadSnapshot {
+    double ppq, bpm, sampleRate;
+    /* when the block starts on the juce::Time::getMillisecondCounterHiRes() clock. that's the host's time if it tells
+    and it's on that clock, or else when the block started processing */
+    double timeMs;
+    juce::int64 timeInSamples;
+    juce::int64 bar; // the bar the block starts in, counted from the start of the song
+    juce::uint64 hostTimeNs;
+    bool isPlaying, hasPlayhead, hasHostTime;
+};
+
+/* single writer that never waits, readers retry if they overlapped with a write */
+template<typename T>
+struct SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+    SeqLock() :
+        seq(0),
+        data()
+    {}
+    void write(const T& value) noexcept {
+        const auto s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&data, &value, sizeof(T));
+        seq.store(s + 2, std::memory_order_release);
+    }
+    T read() const noexcept {
+        T value;
+        for (;;) {
+            const auto s = seq.load(std::memory_order_acquire);
+            if ((s & 1) == 0) {
+                std::memcpy(&value, &data, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq.load(std::memory_order_relaxed) == s)
+                    return value;
+            }
+            juce::Thread::yield();
+        }
+    }
+private:
+    std::atomic<juce::uint32> seq;
+    T data;
+};
+
 class JIFAudioProcessor :
     public juce::AudioProcessor
 {
@@ -42,13 +91,28 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    std::atomic<float> ppq;
-    std::atomic<bool> isPlaying;
-    std::atomic<bool> hasPlayhead;
-    juce::AudioPlayHead::CurrentPositionInfo posInfo;
+    /* the gzipped gif that gets appended to the state if "embedGif" is on.
+    it's kept around compressed, so saving often only costs a copy */
+    void setEmbeddedGif(juce::MemoryBlock&& gzippedGif);
+    juce::MemoryBlock getEmbeddedGif() const;
+    bool hasEmbeddedGif() const;
+
+    SeqLock<PlayheadSnapshot> playhead;
+    perf::Stats perf;
+    double lastBlockMs;
+    /* the input's envelope and onsets, for the audio-reactive sync modes */
+    audio::Analyzer analyzer;
+    audio::Fifo<audio::Event, 512> audioEvents;
+    /* note-ons and mod wheel moves, for the midi sync mode */
+    midi::Queue midiEvents;
+    juce::CriticalSection embeddedGifMutex;
+    juce::MemoryBlock embeddedGif;
     juce::AudioProcessorValueTreeState apvts;
     std::atomic<float>* speed;
     std::atomic<float>* phase;
+    std::atomic<float>* direction;
+    std::atomic<float>* sync;
+    std::atomic<float>* entry;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JIFAudioProcessor)
 };
@@ -0,0 +1,443 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JIF.h"
+
+namespace wt {
+    /* a frame becomes a table with one cycle per row */
+    static constexpr int cyclesPerTable = 256;
+    static constexpr int cycleLengths[] = { 256, 512, 1024, 2048 };
+    static constexpr double sampleRate = 44100.;
+
+    /* row kernels that turn ARGB pixels into samples. brightness is meant like juce::Colour::getBrightness,
+    which is the largest of r, g and b. the pixels are premultiplied, so they read as if drawn onto black */
+    namespace kernel {
+        inline void brightnessRowScalar(const juce::PixelARGB* src, float* dest, const int num) noexcept {
+            for (auto i = 0; i < num; ++i) {
+                const auto brightness = juce::jmax(src[i].getRed(), src[i].getGreen(), src[i].getBlue());
+                dest[i] = static_cast<float>(brightness) * (2.f / 255.f) - 1.f;
+            }
+        }
+        inline void brightnessRow(const juce::PixelARGB* src, float* dest, const int num) noexcept {
+#if JUCE_INTEL
+            const auto lowByte = _mm_set1_epi32(0xff);
+            const auto scale = _mm_set1_ps(2.f / 255.f);
+            const auto one = _mm_set1_ps(1.f);
+            auto i = 0;
+            for (; i + 4 <= num; i += 4) {
+                const auto argb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                const auto rgb = _mm_max_epu8(_mm_max_epu8(argb, _mm_srli_epi32(argb, 8)), _mm_srli_epi32(argb, 16));
+                const auto brightness = _mm_cvtepi32_ps(_mm_and_si128(rgb, lowByte));
+                _mm_storeu_ps(dest + i, _mm_sub_ps(_mm_mul_ps(brightness, scale), one));
+            }
+            brightnessRowScalar(src + i, dest + i, num - i);
+#else
+            brightnessRowScalar(src, dest, num);
+#endif
+        }
+    }
+
+    /* scales frame to the table's size the way the viewer draws it and reads it row by row */
+    inline void renderTable(const juce::Image& frame, juce::AudioBuffer<float>& table, const int cycleLength) {
+        juce::Image scaled(juce::Image::ARGB, cycleLength, cyclesPerTable, true, juce::SoftwareImageType());
+        {
+            juce::Graphics g{ scaled };
+            g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+            g.drawImage(frame, scaled.getBounds().toFloat());
+        }
+        table.setSize(1, cycleLength * cyclesPerTable, false, false, true);
+        auto samples = table.getWritePointer(0);
+        const juce::Image::BitmapData data(scaled, juce::Image::BitmapData::readOnly);
+        for (auto y = 0; y < cyclesPerTable; ++y)
+            kernel::brightnessRow(reinterpret_cast<const juce::PixelARGB*>(data.getLinePointer(y)), samples + y * cycleLength, cycleLength);
+    }
+    /* a single cycle for frame, which is the average of its table's rows */
+    inline void renderCycle(const juce::Image& frame, juce::AudioBuffer<float>& cycle, const int cycleLength) {
+        juce::AudioBuffer<float> table;
+        renderTable(frame, table, cycleLength);
+        cycle.setSize(1, cycleLength, false, false, true);
+        auto samples = cycle.getWritePointer(0);
+        juce::FloatVectorOperations::copy(samples, table.getReadPointer(0), cycleLength);
+        for (auto y = 1; y < cyclesPerTable; ++y)
+            juce::FloatVectorOperations::add(samples, table.getReadPointer(0, y * cycleLength), cycleLength);
+        juce::FloatVectorOperations::multiply(samples, 1.f / static_cast<float>(cyclesPerTable), cycleLength);
+    }
+
+    /* streams a mono 32 bit float wav with the "clm " chunk that wavetable synths read the cycle length from.
+    the sizes in the header get patched when the writer is destroyed */
+    class WavetableWriter :
+        public juce::AudioFormatWriter
+    {
+    public:
+        WavetableWriter(juce::OutputStream* out, const double sr, const int cycleLength) :
+            juce::AudioFormatWriter(out, "Wavetable WAV", sr, 1, 32),
+            riffSizePos(0),
+            dataSizePos(0),
+            numDataBytes(0)
+        {
+            usesFloatingPointData = true;
+            writeHeader(cycleLength);
+        }
+        ~WavetableWriter() override {
+            const auto endPos = output->getPosition();
+            output->setPosition(riffSizePos);
+            output->writeInt(static_cast<int>(endPos - riffSizePos - 4));
+            output->setPosition(dataSizePos);
+            output->writeInt(static_cast<int>(numDataBytes));
+            output->setPosition(endPos);
+            output->flush();
+        }
+        bool write(const int** samplesToWrite, const int numSamples) override {
+            const auto samples = reinterpret_cast<const float*>(samplesToWrite[0]);
+#if JUCE_LITTLE_ENDIAN
+            if (!output->write(samples, static_cast<size_t>(numSamples) * sizeof(float)))
+                return false;
+#else
+            for (auto i = 0; i < numSamples; ++i)
+                if (!output->writeFloat(samples[i]))
+                    return false;
+#endif
+            numDataBytes += static_cast<juce::int64>(numSamples) * 4;
+            return true;
+        }
+    private:
+        juce::int64 riffSizePos, dataSizePos, numDataBytes;
+
+        void writeHeader(const int cycleLength) {
+            output->write("RIFF", 4);
+            riffSizePos = output->getPosition();
+            output->writeInt(0);
+            output->write("WAVE", 4);
+
+            output->write("fmt ", 4);
+            output->writeInt(16);
+            output->writeShort(3); // ieee float
+            output->writeShort(1);
+            output->writeInt(static_cast<int>(sampleRate));
+            output->writeInt(static_cast<int>(sampleRate) * 4);
+            output->writeShort(4);
+            output->writeShort(32);
+
+            const auto clm = "<!>" + juce::String(cycleLength) + " 00000000 wavetable (JIF)";
+            const auto clmSize = static_cast<int>(clm.getNumBytesAsUTF8());
+            output->write("clm ", 4);
+            output->writeInt(clmSize);
+            output->write(clm.toRawUTF8(), static_cast<size_t>(clmSize));
+            if (clmSize % 2 != 0)
+                output->writeByte(0);
+
+            output->write("data", 4);
+            dataSizePos = output->getPosition();
+            output->writeInt(0);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(WavetableWriter)
+    };
+
+    /* opens file for writing from the start, so nothing of an older file remains */
+    inline std::unique_ptr<juce::FileOutputStream> createOutputStream(const juce::File& file) {
+        std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+        if (stream == nullptr || !stream->setPosition(0) || stream->truncate().failed())
+            return nullptr;
+        return stream;
+    }
+
+    inline bool writeTable(const juce::File& file, const juce::AudioBuffer<float>& table) {
+        auto stream = createOutputStream(file);
+        if (stream == nullptr)
+            return false;
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate, 1, 24, {}, 0));
+        if (writer == nullptr)
+            return false;
+        stream.release();
+        return writer->writeFromAudioSampleBuffer(table, 0, table.getNumSamples());
+    }
+
+    /* band-limited versions of a gif's cycles, one mip level per octave.
+    level 0 keeps every harmonic a cycle can hold below nyquist, each further level half as many */
+    struct MipSet {
+        int cycleLength, numCycles, numLevels;
+        /* level by level, cycle by cycle */
+        std::vector<float> samples;
+
+        float* getCycle(const int level, const int cycle) noexcept {
+            return samples.data() + (static_cast<size_t>(level) * numCycles + cycle) * cycleLength;
+        }
+        const float* getCycle(const int level, const int cycle) const noexcept {
+            return samples.data() + (static_cast<size_t>(level) * numCycles + cycle) * cycleLength;
+        }
+        int getNumHarmonics(const int level) const noexcept { return juce::jmax(1, (cycleLength / 2) >> level); }
+    };
+
+    /* level 0 of the mip set has to hold the raw cycles already. each cycle loses its dc
+    and gets normalized to its level 0 peak, with the same gain on all of its levels */
+    inline void bandLimit(MipSet& mips, const int firstCycle, const int numCycles) {
+        const auto n = mips.cycleLength;
+        juce::dsp::FFT fft(juce::roundToInt(std::log2(n)));
+        std::vector<float> spectrum(static_cast<size_t>(2 * n)), bins(spectrum.size());
+        for (auto c = firstCycle; c < firstCycle + numCycles; ++c) {
+            std::fill(spectrum.begin(), spectrum.end(), 0.f);
+            std::copy(mips.getCycle(0, c), mips.getCycle(0, c) + n, spectrum.begin());
+            fft.performRealOnlyForwardTransform(spectrum.data());
+            spectrum[0] = spectrum[1] = 0.f;
+            for (auto level = mips.numLevels - 1; level >= 0; --level) {
+                const auto numHarmonics = mips.getNumHarmonics(level);
+                bins = spectrum;
+                /* complex bins, with the negative frequencies mirrored from n/2 upwards. nyquist always goes */
+                for (auto k = numHarmonics + 1; k < n - numHarmonics; ++k)
+                    bins[2 * k] = bins[2 * k + 1] = 0.f;
+                bins[n] = bins[n + 1] = 0.f;
+                fft.performRealOnlyInverseTransform(bins.data());
+                std::copy(bins.begin(), bins.begin() + n, mips.getCycle(level, c));
+            }
+            const auto range = juce::FloatVectorOperations::findMinAndMax(mips.getCycle(0, c), n);
+            const auto peak = juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+            if (peak > 0.f)
+                for (auto level = 0; level < mips.numLevels; ++level)
+                    juce::FloatVectorOperations::multiply(mips.getCycle(level, c), 1.f / peak, n);
+        }
+    }
+
+    /* writes the wavetables of a gif in the background. the images get composited in order on this thread,
+    while scaling and reading them is spread across the cores */
+    class Exporter :
+        public juce::Thread
+    {
+    public:
+        enum class Mode {
+            /* a folder with one wav per image, each a table with one cycle per row */
+            TablePerImage,
+            /* one wav with a cycle per image of the loop range */
+            SingleFile,
+            /* a folder with a single file wav per octave, band-limited to what that octave can play without aliasing */
+            MipMapped
+        };
+        struct Options {
+            Mode mode;
+            int cycleLength;
+        };
+
+        /* maxThreads limits how many of the shared pool's threads it uses at once */
+        Exporter(const int maxThreads = juce::SystemStats::getNumCpus()) :
+            juce::Thread("JIF Wavetable Exporter"),
+            jobs(),
+            numThreads(juce::jmax(1, juce::jmin(maxThreads, jobs.getNumThreads()))),
+            images(),
+            bgColour(0x00000000),
+            width(0), height(0),
+            destination(),
+            options{ Mode::TablePerImage, 2048 },
+            firstIdx(0),
+            numTables(0),
+            mipMutex(),
+            mipSet(),
+            mipKey(),
+            numDone(0),
+            numSteps(0)
+        {}
+        ~Exporter() override { cancel(); }
+        /* destination is the wav file for a single file export, a directory otherwise */
+        void start(const jif::JIF& jif, const juce::File& dest, const Options& opts) {
+            cancel();
+            if (prepare(jif, dest, opts))
+                startThread();
+        }
+        /* like start, but exports on the calling thread and returns when it's done */
+        void exportNow(const jif::JIF& jif, const juce::File& dest, const Options& opts) {
+            cancel();
+            if (prepare(jif, dest, opts))
+                run();
+        }
+        /* the cycles that are being rendered get finished, the queued ones are dropped */
+        void cancel() {
+            signalThreadShouldExit();
+            jobs.cancel();
+            stopThread(4000);
+            images.clear();
+        }
+        bool isExporting() const { return isThreadRunning(); }
+        /* from 0 to 1 */
+        float getProgress() const noexcept {
+            const auto total = numSteps.load();
+            return total == 0 ? 0.f : static_cast<float>(numDone.load()) / static_cast<float>(total);
+        }
+        /* the mip set of the last mipmapped export, or nullptr */
+        std::shared_ptr<const MipSet> getMipSet() const {
+            const juce::ScopedLock lock(mipMutex);
+            return mipSet;
+        }
+    private:
+        jif::PoolJobs jobs;
+        const int numThreads;
+        std::vector<jif::Image> images;
+        juce::Colour bgColour;
+        int width, height;
+        juce::File destination;
+        Options options;
+        int firstIdx, numTables;
+        /* what the cached mip set got built from, so exporting it again doesn't need to recompute it */
+        struct MipKey {
+            juce::Image firstImage;
+            int firstIdx, numTables, cycleLength;
+
+            bool operator==(const MipKey& other) const noexcept {
+                return firstImage == other.firstImage && firstIdx == other.firstIdx
+                    && numTables == other.numTables && cycleLength == other.cycleLength;
+            }
+        };
+        juce::CriticalSection mipMutex;
+        std::shared_ptr<const MipSet> mipSet;
+        MipKey mipKey;
+        std::atomic<int> numDone, numSteps;
+
+        bool prepare(const jif::JIF& jif, const juce::File& dest, const Options& opts) {
+            if (jif.empty())
+                return false;
+            images = jif.images;
+            bgColour = jif.bgColour;
+            width = jif.width;
+            height = jif.height;
+            destination = dest;
+            options = opts;
+            const auto loopRangeOnly = options.mode != Mode::TablePerImage;
+            firstIdx = loopRangeOnly ? jif.getLoopStart() : 0;
+            numTables = (loopRangeOnly ? jif.getLoopEnd() : static_cast<int>(images.size())) - firstIdx;
+            numDone = 0;
+            numSteps = options.mode == Mode::MipMapped ? numTables * 2 : numTables;
+            return true;
+        }
+        void run() override {
+            if (options.mode == Mode::SingleFile)
+                writeSingleFile();
+            else if (options.mode == Mode::MipMapped)
+                writeMipMapped();
+            else
+                writeTablePerImage();
+            /* holding on to the images would keep the gif alive after it's been replaced */
+            images.clear();
+        }
+        void writeTablePerImage() {
+            const auto cycleLength = options.cycleLength;
+            destination.createDirectory();
+            destination.getChildFile("FolderInfo.txt").replaceWithText("[" + juce::String(cycleLength) + "]");
+            jif::Compositor compositor(jif::Compositor::Access::Sequential);
+            /* keeps the composited frames that wait for a job from piling up */
+            const auto maxJobs = numThreads * 2;
+            for (auto i = 0; i < numTables && !threadShouldExit(); ++i) {
+                while (jobs.getNumJobs() >= maxJobs && !threadShouldExit())
+                    wait(2);
+                const auto frame = compositor.getFrame(images, width, height, bgColour, firstIdx + i).createCopy();
+                const auto file = destination.getChildFile("wt" + juce::String(i) + ".wav");
+                jobs.add([this, frame, file, cycleLength]() {
+                    if (threadShouldExit())
+                        return;
+                    juce::AudioBuffer<float> table;
+                    renderTable(frame, table, cycleLength);
+                    writeTable(file, table);
+                    ++numDone;
+                });
+            }
+            jobs.waitForAll();
+        }
+        /* the cycles get rendered a batch at a time and streamed to the file in order,
+        so memory stays the same no matter how many images there are */
+        void writeSingleFile() {
+            auto stream = createOutputStream(destination);
+            if (stream == nullptr)
+                return;
+            const auto cycleLength = options.cycleLength;
+            WavetableWriter writer(stream.release(), sampleRate, cycleLength);
+            jif::Compositor compositor(jif::Compositor::Access::Sequential);
+            const auto batchSize = numThreads;
+            std::vector<juce::AudioBuffer<float>> cycles(static_cast<size_t>(batchSize));
+            for (auto i = 0; i < numTables && !threadShouldExit(); i += batchSize) {
+                const auto numInBatch = juce::jmin(batchSize, numTables - i);
+                for (auto j = 0; j < numInBatch; ++j) {
+                    const auto frame = compositor.getFrame(images, width, height, bgColour, firstIdx + i + j).createCopy();
+                    auto& cycle = cycles[static_cast<size_t>(j)];
+                    jobs.add([this, frame, &cycle, cycleLength]() {
+                        if (!threadShouldExit())
+                            renderCycle(frame, cycle, cycleLength);
+                    });
+                }
+                /* the jobs refer to cycles, so they have to finish or be dropped either way */
+                jobs.waitForAll();
+                if (threadShouldExit())
+                    return;
+                for (auto j = 0; j < numInBatch; ++j) {
+                    writer.writeFromAudioSampleBuffer(cycles[static_cast<size_t>(j)], 0, cycleLength);
+                    ++numDone;
+                }
+            }
+        }
+
+        void writeMipMapped() {
+            const MipKey key{ images.front().indices, firstIdx, numTables, options.cycleLength };
+            auto mips = getMipSet();
+            {
+                const juce::ScopedLock lock(mipMutex);
+                if (!(mipKey == key))
+                    mips.reset();
+            }
+            if (mips == nullptr) {
+                mips = createMipSet();
+                if (mips == nullptr)
+                    return;
+                const juce::ScopedLock lock(mipMutex);
+                mipSet = mips;
+                mipKey = key;
+            }
+            else
+                numDone = numTables * 2;
+            destination.createDirectory();
+            for (auto level = 0; level < mips->numLevels && !threadShouldExit(); ++level) {
+                auto stream = createOutputStream(destination.getChildFile("octave" + juce::String(level) + ".wav"));
+                if (stream == nullptr)
+                    return;
+                WavetableWriter writer(stream.release(), sampleRate, mips->cycleLength);
+                const float* channels[] = { mips->getCycle(level, 0) };
+                writer.writeFromFloatArrays(channels, 1, mips->cycleLength * mips->numCycles);
+            }
+        }
+        /* renders the cycles on the pool and then band-limits them in one batch of cycles per thread */
+        std::shared_ptr<const MipSet> createMipSet() {
+            auto mips = std::make_shared<MipSet>();
+            mips->cycleLength = options.cycleLength;
+            mips->numCycles = numTables;
+            mips->numLevels = juce::roundToInt(std::log2(options.cycleLength));
+            mips->samples.resize(static_cast<size_t>(mips->numLevels * mips->numCycles * mips->cycleLength));
+            jif::Compositor compositor(jif::Compositor::Access::Sequential);
+            const auto maxJobs = numThreads * 2;
+            for (auto i = 0; i < numTables && !threadShouldExit(); ++i) {
+                while (jobs.getNumJobs() >= maxJobs && !threadShouldExit())
+                    wait(2);
+                const auto frame = compositor.getFrame(images, width, height, bgColour, firstIdx + i).createCopy();
+                jobs.add([this, frame, &mips, i]() {
+                    if (threadShouldExit())
+                        return;
+                    juce::AudioBuffer<float> cycle;
+                    renderCycle(frame, cycle, mips->cycleLength);
+                    std::copy(cycle.getReadPointer(0), cycle.getReadPointer(0) + mips->cycleLength, mips->getCycle(0, i));
+                    ++numDone;
+                });
+            }
+            const auto batchSize = (numTables + numThreads - 1) / numThreads;
+            /* the jobs refer to mips, so they have to finish or be dropped either way */
+            jobs.waitForAll();
+            for (auto i = 0; i < numTables && !threadShouldExit(); i += batchSize)
+                jobs.add([this, &mips, i, batchSize]() {
+                    if (threadShouldExit())
+                        return;
+                    const auto numInBatch = juce::jmin(batchSize, mips->numCycles - i);
+                    bandLimit(*mips, i, numInBatch);
+                    numDone += numInBatch;
+                });
+            jobs.waitForAll();
+            if (threadShouldExit())
+                return nullptr;
+            return mips;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Exporter)
+    };
+}